@@ -237,9 +237,11 @@ void Item_UpdateState( edict_t * item ) {
 	if ( item->solid == SOLID_NOT ) {
 		item->sv.ent_flags |= SVFL_IS_HIDDEN;
 
-		if ( item->nextthink.milliseconds() > 0 ) {
+		// pending respawns come straight off the respawn wheel
+		const gtime_t pendingRespawnTime = G_ItemRespawnPending( item );
+
+		if ( pendingRespawnTime.milliseconds() > 0 || item->nextthink.milliseconds() > 0 ) {
 			if ( ( item->svflags & SVF_RESPAWNING ) != 0 ) {
-				const gtime_t pendingRespawnTime = ( item->nextthink - level.time );
 				item->sv.respawntime = static_cast<int32_t>( pendingRespawnTime.milliseconds() );
 			} else {
 				// item will respawn at some unknown time in the future...
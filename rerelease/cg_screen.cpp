@@ -2,6 +2,8 @@
 // Licensed under the GNU General Public License 2.0.
 #include "cg_local.h"
 
+#include <string_view>
+
 constexpr int32_t STAT_MINUS      = 10;  // num frame for '-' stats digit
 constexpr const char *sb_nums[2][11] =
 {
@@ -44,19 +46,41 @@ static struct
 } hud_temp;
 
 #include <vector>
+#include <array>
 
 // max number of centerprints in the rotating buffer
 constexpr size_t MAX_CENTER_PRINTS = 4;
 
+// Sarah: centerprints are parsed once into a fixed per-center arena instead of
+// a string plus vectors of strings; binds and lines are terminated slices of
+// `text`, and the byte size of every codepoint is stored so the typing effect
+// can step a character without re-scanning the line.
+constexpr size_t MAX_CENTER_TEXT = MAX_STRING_CHARS;
+constexpr size_t MAX_CENTER_LINES = 64;
+constexpr size_t MAX_CENTER_BINDS = 8;
+
 struct cl_bind_t {
-    std::string bind;
-    std::string purpose;
+    const char *bind;
+    const char *purpose;
+};
+
+struct cl_center_line_t {
+    uint16_t    start; // offset into text
+    uint16_t    length; // in bytes
+    float       width; // for the contrast bar, valid at measure_scale
 };
 
 struct cl_centerprint_t {
-    std::vector<cl_bind_t> binds; // binds
+    char        text[MAX_CENTER_TEXT]; // arena; binds and lines point in here
+    uint8_t     codepoint_size[MAX_CENTER_TEXT]; // bytes in the codepoint starting here
 
-    std::vector<std::string> lines;
+    std::array<cl_bind_t, MAX_CENTER_BINDS> binds; // binds
+    size_t      num_binds;
+
+    std::array<cl_center_line_t, MAX_CENTER_LINES> lines;
+    size_t      num_lines;
+    int32_t     measure_scale; // scale line widths were measured at, 0 if not yet
+    uint32_t    measure_generation; // font_generation they were measured under
     bool        instant; // don't type out
 
     size_t      current_line; // current line we're typing out
@@ -86,12 +110,14 @@ layout_flags_t CG_LayoutFlags(const player_state_t *ps)
 }
 
 #include <optional>
-#include <array>
 
 constexpr size_t MAX_NOTIFY = 8;
 
 struct cl_notify_t {
-    std::string     message; // utf8 message
+    char            message[MAX_STRING_CHARS]; // utf8 message
+    float           width; // for the contrast bar, valid at measure_scale
+    int32_t         measure_scale; // 0 if not measured yet
+    uint32_t        measure_generation; // font_generation it was measured under
     bool            is_active; // filled or not
     bool            is_chat; // green or not
     uint64_t        time; // rotate us when < CL_Time()
@@ -106,6 +132,111 @@ struct hud_data_t {
 
 static std::array<hud_data_t, MAX_SPLIT_PLAYERS> hud_data;
 
+// Sarah: centerprint, notify and table text doesn't change once received, but
+// it was being re-measured every frame for every split view. Measurements of
+// those (and only those) go through a small direct-mapped cache of fixed
+// slots keyed by (text, scale, typeface); a colliding string just takes the
+// slot over, text too long for a slot is measured directly, and nothing here
+// ever allocates. The slots are emptied whenever the font cvars change.
+constexpr size_t MAX_FONT_MEASURES = 256; // power of two
+constexpr size_t MAX_FONT_MEASURE_TEXT = 128;
+
+struct cg_font_measure_t {
+    char        text[MAX_FONT_MEASURE_TEXT]; // empty if unused
+    int32_t     scale;
+    bool        alt_typeface;
+    vec2_t      size;
+};
+
+static std::array<cg_font_measure_t, MAX_FONT_MEASURES> font_measures;
+static bool font_alt_typeface;
+static int32_t font_usekfont_modified, font_alttypeface_modified;
+// bumped whenever measurements go stale, so the widths kept with each
+// centerprint and notify can tell without being walked
+static uint32_t font_generation = 1;
+// scale each split last drew at, so new lines can be measured as they arrive
+static std::array<int32_t, MAX_SPLIT_PLAYERS> hud_scales;
+
+static void CG_SetAltTypeface(bool enabled)
+{
+    font_alt_typeface = enabled;
+    cgi.SCR_SetAltTypeface(enabled);
+}
+
+static void CG_ClearFontMeasures()
+{
+    for (auto &m : font_measures)
+        m.text[0] = '\0';
+
+    font_generation++;
+}
+
+static void CG_CheckFontMeasures()
+{
+    bool changed = Cvar_WasModified(scr_usekfont, font_usekfont_modified);
+    changed = Cvar_WasModified(ui_acc_alttypeface, font_alttypeface_modified) || changed;
+
+    if (changed)
+        CG_ClearFontMeasures();
+}
+
+static vec2_t CG_MeasureFontString(const char *str, int32_t scale)
+{
+    std::string_view text(str);
+
+    if (text.empty() || text.size() >= MAX_FONT_MEASURE_TEXT)
+        return cgi.SCR_MeasureFontString(str, scale);
+
+    size_t key = std::hash<std::string_view>()(text);
+    key ^= ((size_t) scale * 0x9E3779B9u) + (font_alt_typeface ? 0x7F4A7C15u : 0);
+
+    cg_font_measure_t &m = font_measures[key & (MAX_FONT_MEASURES - 1)];
+
+    if (m.scale == scale && m.alt_typeface == font_alt_typeface && text == m.text)
+        return m.size;
+
+    m.size = cgi.SCR_MeasureFontString(str, scale);
+    memcpy(m.text, str, text.size() + 1);
+    m.scale = scale;
+    m.alt_typeface = font_alt_typeface;
+    return m.size;
+}
+
+// Sarah: centerprint and notify contrast bars keep their widths with the text
+// they belong to, measured when the text arrives at the scale that split last
+// drew with; they're only re-measured if the scale or font changes after that.
+static void CG_MeasureCenterLines(cl_centerprint_t &center, int32_t scale)
+{
+    for (size_t i = 0; i < center.num_lines; i++)
+    {
+        const char *line = center.text + center.lines[i].start;
+        center.lines[i].width = *line ? CG_MeasureFontString(line, scale).x : 0.f;
+    }
+
+    center.measure_scale = scale;
+    center.measure_generation = font_generation;
+}
+
+static float CG_CenterLineWidth(cl_centerprint_t &center, size_t line, int32_t scale)
+{
+    if (center.measure_scale != scale || center.measure_generation != font_generation)
+        CG_MeasureCenterLines(center, scale);
+
+    return center.lines[line].width;
+}
+
+static float CG_NotifyWidth(cl_notify_t &msg, int32_t scale)
+{
+    if (msg.measure_scale != scale || msg.measure_generation != font_generation)
+    {
+        msg.width = CG_MeasureFontString(msg.message, scale).x;
+        msg.measure_scale = scale;
+        msg.measure_generation = font_generation;
+    }
+
+    return msg.width;
+}
+
 void CG_ClearCenterprint(int32_t isplit)
 {
     hud_data[isplit].center_index = {};
@@ -132,12 +263,12 @@ static void CG_Notify_CheckExpire(hud_data_t &data)
 }
 
 // add notify to list
-static void CG_AddNotify(hud_data_t &data, const char *msg, bool is_chat)
+static cl_notify_t *CG_AddNotify(hud_data_t &data, const char *msg, bool is_chat)
 {
     size_t i = 0;
 
     if (scr_maxlines->integer <= 0)
-        return;
+        return nullptr;
 
     const int max = min(MAX_NOTIFY, (size_t)scr_maxlines->integer);
 
@@ -153,10 +284,13 @@ static void CG_AddNotify(hud_data_t &data, const char *msg, bool is_chat)
         i = max - 1;
     }
     
-    data.notify[i].message.assign(msg);
+    Q_strlcpy(data.notify[i].message, msg, sizeof(data.notify[i].message));
     data.notify[i].is_active = true;
     data.notify[i].is_chat = is_chat;
     data.notify[i].time = cgi.CL_ClientTime() + (cl_notifytime->value * 1000);
+    data.notify[i].measure_scale = 0;
+
+    return &data.notify[i];
 }
 
 // draw notifies
@@ -170,18 +304,17 @@ static void CG_DrawNotify(int32_t isplit, vrect_t hud_vrect, vrect_t hud_safe, i
     
     y = (hud_vrect.y * scale) + hud_safe.y;
 
-    cgi.SCR_SetAltTypeface(ui_acc_alttypeface->integer && true);
+    CG_SetAltTypeface(ui_acc_alttypeface->integer && true);
 
     if (ui_acc_contrast->integer)
     {
         for (auto& msg : data.notify)
         {
-            if (!msg.is_active || !msg.message.length())
+            if (!msg.is_active || !msg.message[0])
                 break;
 
-            vec2_t sz = cgi.SCR_MeasureFontString(msg.message.c_str(), scale);
-            sz.x += 10; // extra padding for black bars
-            cgi.SCR_DrawColorPic((hud_vrect.x * scale) + hud_safe.x - 5, y, sz.x, 15 * scale, "_white", rgba_black);
+            float width = CG_NotifyWidth(msg, scale) + 10; // extra padding for black bars
+            cgi.SCR_DrawColorPic((hud_vrect.x * scale) + hud_safe.x - 5, y, width, 15 * scale, "_white", rgba_black);
             y += 10 * scale;
         }
     }
@@ -192,11 +325,11 @@ static void CG_DrawNotify(int32_t isplit, vrect_t hud_vrect, vrect_t hud_safe, i
         if (!msg.is_active)
             break;
 
-        cgi.SCR_DrawFontString(msg.message.c_str(), (hud_vrect.x * scale) + hud_safe.x, y, scale, msg.is_chat ? alt_color : rgba_white, true, text_align_t::LEFT);
+        cgi.SCR_DrawFontString(msg.message, (hud_vrect.x * scale) + hud_safe.x, y, scale, msg.is_chat ? alt_color : rgba_white, true, text_align_t::LEFT);
         y += 10 * scale;
     }
 
-    cgi.SCR_SetAltTypeface(false);
+    CG_SetAltTypeface(false);
 
     // draw text input (only the main player can really chat anyways...)
     if (isplit == 0)
@@ -214,10 +347,11 @@ static void CG_DrawNotify(int32_t isplit, vrect_t hud_vrect, vrect_t hud_safe, i
 CG_DrawHUDString
 ==============
 */
-static int CG_DrawHUDString (const char *string, int x, int y, int centerwidth, int _xor, int scale, bool shadow = true)
+static int CG_DrawHUDString (const char *string, int x, int y, int centerwidth, int _xor, int scale, bool shadow = true, bool cache_measure = false)
 {
     int     margin;
-    char    line[1024];
+    char    buffer[1024];
+    const char *line;
     int     width;
     int     i;
 
@@ -225,16 +359,29 @@ static int CG_DrawHUDString (const char *string, int x, int y, int centerwidth,
 
     while (*string)
     {
-        // scan out one line of text from the string
+        // scan out one line of text from the string; the last (usually only)
+        // line is already terminated, so only copy when there's more after it
         width = 0;
+        while (string[width] && string[width] != '\n')
+            width++;
+
+        if (!string[width])
+            line = string;
+        else
+        {
+            width = min(width, (int) sizeof(buffer) - 1);
+            memcpy(buffer, string, width);
+            buffer[width] = 0;
+            line = buffer;
+        }
+
         while (*string && *string != '\n')
-            line[width++] = *string++;
-        line[width] = 0;
+            string++;
 
         vec2_t size;
         
         if (scr_usekfont->integer)
-            size = cgi.SCR_MeasureFontString(line, scale);
+            size = cache_measure ? CG_MeasureFontString(line, scale) : cgi.SCR_MeasureFontString(line, scale);
 
         if (centerwidth)
         {
@@ -340,7 +487,16 @@ size_t FindEndOfUTF8Codepoint(const std::string &str, size_t pos)
 
 void CG_NotifyMessage(int32_t isplit, const char *msg, bool is_chat)
 {
-    CG_AddNotify(hud_data[isplit], msg, is_chat);
+    cl_notify_t *notify = CG_AddNotify(hud_data[isplit], msg, is_chat);
+
+    // notifies are only measured for the contrast bars
+    if (notify && ui_acc_contrast->integer && hud_scales[isplit] && *msg)
+    {
+        const bool prev = font_alt_typeface;
+        CG_SetAltTypeface(ui_acc_alttypeface->integer);
+        CG_NotifyWidth(*notify, hud_scales[isplit]);
+        CG_SetAltTypeface(prev);
+    }
 }
 
 // centerprint stuff
@@ -354,7 +510,7 @@ static cl_centerprint_t &CG_QueueCenterPrint(int isplit, bool instant)
         icl.center_index = 0;
 
         for (size_t i = 1; i < MAX_CENTER_PRINTS; i++)
-            icl.centers[i].lines.clear();
+            icl.centers[i].num_lines = 0;
 
         return icl.centers[0];
     }
@@ -364,7 +520,7 @@ static cl_centerprint_t &CG_QueueCenterPrint(int isplit, bool instant)
     {
         auto &center = icl.centers[(icl.center_index.value() + i) % MAX_CENTER_PRINTS];
 
-        if (center.lines.empty())
+        if (!center.num_lines)
             return center;
     }
     
@@ -392,37 +548,44 @@ void CG_ParseCenterPrint (const char *str, int isplit, bool instant) // [Sam-KEX
     // handle center queueing
     cl_centerprint_t &center = CG_QueueCenterPrint(isplit, instant);
 
-    center.lines.clear();
+    center.num_lines = 0;
+    center.num_binds = 0;
 
-    // split the string into lines
-    size_t line_start = 0;
+    size_t length = Q_strlcpy(center.text, str, sizeof(center.text));
 
-    std::string string(str);
+    if (length >= sizeof(center.text))
+        length = sizeof(center.text) - 1;
 
-    center.binds.clear();
+    char *string = center.text;
 
     // [Paril-KEX] pull out bindings. they'll always be at the start
-    while (string.compare(0, 6, "%bind:") == 0)
+    while (!strncmp(string, "%bind:", 6))
     {
-        size_t end_of_bind = string.find_first_of('%', 1);
+        char *end_of_bind = strchr(string + 1, '%');
 
-        if (end_of_bind == std::string::npos)
+        if (!end_of_bind)
             break;
 
-        std::string bind = string.substr(6, end_of_bind - 6);
+        *end_of_bind = '\0';
 
-        if (auto purpose_index = bind.find_first_of(':'); purpose_index != std::string::npos)
-            center.binds.emplace_back(cl_bind_t { bind.substr(0, purpose_index), bind.substr(purpose_index + 1) });
+        char *bind = string + 6;
+        char *purpose = strchr(bind, ':');
+
+        if (purpose)
+            *purpose++ = '\0';
         else
-            center.binds.emplace_back(cl_bind_t { bind });
+            purpose = end_of_bind; // empty
+
+        if (center.num_binds < MAX_CENTER_BINDS)
+            center.binds[center.num_binds++] = cl_bind_t { bind, purpose };
 
-        string = string.substr(end_of_bind + 1);
+        string = end_of_bind + 1;
     }
 
     // echo it to the console
     cgi.Com_Print("\n\n\35\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\37\n\n");
 
-    s = string.c_str();
+    s = string;
     do
     {
         // scan the width of the line
@@ -452,42 +615,58 @@ void CG_ParseCenterPrint (const char *str, int isplit, bool instant) // [Sam-KEX
     cgi.Com_Print("\n\n\35\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\36\37\n\n");
     CG_ClearNotify (isplit);
 
-    for (size_t line_end = 0; ; )
-    {
-        line_end = FindEndOfUTF8Codepoint(string, line_end);
+    // split the string into lines in place, sizing codepoints as we go
+    const size_t text_end = length;
+    size_t line_start = string - center.text;
 
-        if (line_end == std::string::npos)
+    for (size_t p = line_start; ; )
+    {
+        if (p >= text_end)
         {
             // final line
-            if (line_start < string.size())
-                center.lines.emplace_back(string.c_str() + line_start);
+            if (line_start < text_end && center.num_lines < MAX_CENTER_LINES)
+                center.lines[center.num_lines++] = { (uint16_t) line_start, (uint16_t) (text_end - line_start) };
             break;
         }
-        
+
         // char part of current line;
         // if newline, end line and cut off
-        const char &ch = string[line_end];
-
-        if (ch == '\n')
+        if (center.text[p] == '\n')
         {
-            if (line_end > line_start)
-                center.lines.emplace_back(string.c_str() + line_start, line_end - line_start);
-            else
-                center.lines.emplace_back();
-            line_start = line_end + 1;
-            line_end++;
+            center.text[p] = '\0';
+            center.codepoint_size[p] = 1;
+
+            if (center.num_lines < MAX_CENTER_LINES)
+                center.lines[center.num_lines++] = { (uint16_t) line_start, (uint16_t) (p - line_start) };
+            line_start = ++p;
             continue;
         }
 
-         line_end++;
+        size_t cp_end = p + 1;
+
+        while (cp_end < text_end && (center.text[cp_end] & 0xC0) == 0x80)
+            cp_end++;
+
+        center.codepoint_size[p] = (uint8_t) (cp_end - p);
+        p = cp_end;
     }
 
-    if (center.lines.empty())
+    if (!center.num_lines)
     {
         center.finished = true;
         return;
     }
 
+    center.measure_scale = 0;
+
+    if (hud_scales[isplit] && (scr_usekfont->integer || ui_acc_contrast->integer))
+    {
+        const bool prev = font_alt_typeface;
+        CG_SetAltTypeface(ui_acc_alttypeface->integer);
+        CG_MeasureCenterLines(center, hud_scales[isplit]);
+        CG_SetAltTypeface(prev);
+    }
+
     center.time_tick = cgi.CL_ClientRealTime() + (scr_printspeed->value * 1000);
     center.instant = instant;
     center.finished = false;
@@ -501,7 +680,7 @@ static void CG_DrawCenterString( const player_state_t *ps, const vrect_t &hud_vr
     
     if (CG_ViewingLayout(ps))
         y += hud_safe.y;
-    else if (center.lines.size() <= 4)
+    else if (center.num_lines <= 4)
         y += (hud_vrect.height * 0.2f) * scale;
     else
         y += 48 * scale;
@@ -512,30 +691,30 @@ static void CG_DrawCenterString( const player_state_t *ps, const vrect_t &hud_vr
     // easy!
     if (center.instant)
     {
-        for (size_t i = 0; i < center.lines.size(); i++)
+        for (size_t i = 0; i < center.num_lines; i++)
         {
-            auto &line = center.lines[i];
+            const char *line = center.text + center.lines[i].start;
 
-            cgi.SCR_SetAltTypeface(ui_acc_alttypeface->integer && true);
+            CG_SetAltTypeface(ui_acc_alttypeface->integer && true);
 
-            if (ui_acc_contrast->integer && line.length())
+            if (ui_acc_contrast->integer && *line)
             {
-                vec2_t sz = cgi.SCR_MeasureFontString(line.c_str(), scale);
-                sz.x += 10; // extra padding for black bars
+                float width = CG_CenterLineWidth(center, i, scale) + 10; // extra padding for black bars
                 int barY = ui_acc_alttypeface->integer ? y - 8 : y;
-                cgi.SCR_DrawColorPic((hud_vrect.x + hud_vrect.width / 2) * scale - (sz.x / 2), barY, sz.x, lineHeight, "_white", rgba_black);
+                cgi.SCR_DrawColorPic((hud_vrect.x + hud_vrect.width / 2) * scale - (width / 2), barY, width, lineHeight, "_white", rgba_black);
             }
-            CG_DrawHUDString(line.c_str(), (hud_vrect.x + hud_vrect.width/2 + -160) * scale, y, (320 / 2) * 2 * scale, 0, scale);
+            CG_DrawHUDString(line, (hud_vrect.x + hud_vrect.width/2 + -160) * scale, y, (320 / 2) * 2 * scale, 0, scale, true, true);
 
-            cgi.SCR_SetAltTypeface(false);
+            CG_SetAltTypeface(false);
 
             y += lineHeight;
         }
 
-        for (auto &bind : center.binds)
+        for (size_t i = 0; i < center.num_binds; i++)
         {
+            auto &bind = center.binds[i];
             y += lineHeight * 2;
-            cgi.SCR_DrawBind(isplit, bind.bind.c_str(), bind.purpose.c_str(), (hud_vrect.x + (hud_vrect.width / 2)) * scale, y, scale);
+            cgi.SCR_DrawBind(isplit, bind.bind, bind.purpose, (hud_vrect.x + (hud_vrect.width / 2)) * scale, y, scale);
         }
 
         if (!center.finished)
@@ -556,14 +735,17 @@ static void CG_DrawCenterString( const player_state_t *ps, const vrect_t &hud_vr
         if (center.time_tick < t)
         {
             center.time_tick = t + (scr_printspeed->value * 1000);
-            center.line_count = FindEndOfUTF8Codepoint(center.lines[center.current_line], center.line_count + 1);
+            const cl_center_line_t &line = center.lines[center.current_line];
+
+            if (line.length)
+                center.line_count += center.codepoint_size[line.start + center.line_count];
 
-            if (center.line_count == std::string::npos)
+            if (center.line_count >= line.length)
             {
                 center.current_line++;
                 center.line_count = 0;
 
-                if (center.current_line == center.lines.size())
+                if (center.current_line == center.num_lines)
                 {
                     center.current_line--;
                     center.finished = true;
@@ -576,35 +758,36 @@ static void CG_DrawCenterString( const player_state_t *ps, const vrect_t &hud_vr
     // smallish byte buffer for single line of data...
     char buffer[256];
 
-    for (size_t i = 0; i < center.lines.size(); i++)
+    for (size_t i = 0; i < center.num_lines; i++)
     {
-        cgi.SCR_SetAltTypeface(ui_acc_alttypeface->integer && true);
+        CG_SetAltTypeface(ui_acc_alttypeface->integer && true);
 
-        auto &line = center.lines[i];
+        const char *line = center.text + center.lines[i].start;
+
+        const char *text = buffer;
 
         buffer[0] = 0;
 
         if (center.finished || i != center.current_line)
-            Q_strlcpy(buffer, line.c_str(), sizeof(buffer));
+            text = line;
         else
-            Q_strlcpy(buffer, line.c_str(), min(center.line_count + 1, sizeof(buffer)));
+            Q_strlcpy(buffer, line, min(center.line_count + 1, sizeof(buffer)));
 
         int blinky_x;
 
-        if (ui_acc_contrast->integer && line.length())
+        if (ui_acc_contrast->integer && *line)
         {
-            vec2_t sz = cgi.SCR_MeasureFontString(line.c_str(), scale);
-            sz.x += 10; // extra padding for black bars
+            float width = CG_CenterLineWidth(center, i, scale) + 10; // extra padding for black bars
             int barY = ui_acc_alttypeface->integer ? y - 8 : y;
-            cgi.SCR_DrawColorPic((hud_vrect.x + hud_vrect.width / 2) * scale - (sz.x / 2), barY, sz.x, lineHeight, "_white", rgba_black);
+            cgi.SCR_DrawColorPic((hud_vrect.x + hud_vrect.width / 2) * scale - (width / 2), barY, width, lineHeight, "_white", rgba_black);
         }
         
-        if (buffer[0])
-            blinky_x = CG_DrawHUDString(buffer, (hud_vrect.x + hud_vrect.width/2 + -160) * scale, y, (320 / 2) * 2 * scale, 0, scale);
+        if (text[0])
+            blinky_x = CG_DrawHUDString(text, (hud_vrect.x + hud_vrect.width/2 + -160) * scale, y, (320 / 2) * 2 * scale, 0, scale, true, text == line);
         else
             blinky_x = (hud_vrect.width / 2) * scale;
 
-        cgi.SCR_SetAltTypeface(false);
+        CG_SetAltTypeface(false);
 
         if (i == center.current_line && !ui_acc_alttypeface->integer)
             cgi.SCR_DrawChar(blinky_x, y, scale, 10 + ((cgi.CL_ClientRealTime() >> 8) & 1), true);
@@ -629,13 +812,13 @@ static void CG_CheckDrawCenterString( const player_state_t *ps, const vrect_t &h
     // ran out of center time
     if (center.finished && center.time_off < cgi.CL_ClientRealTime())
     {
-        center.lines.clear();
+        center.num_lines = 0;
 
         size_t next_index = (data.center_index.value() + 1) % MAX_CENTER_PRINTS;
         auto &next_center = data.centers[next_index];
 
         // no more
-        if (next_center.lines.empty())
+        if (!next_center.num_lines)
         {
             data.center_index.reset();
             return;
@@ -756,12 +939,12 @@ static void CG_DrawTable(int x, int y, uint32_t width, uint32_t height, int32_t
             if (r == 0)
             {
                 x_offset = ((hud_temp.column_widths[i]) / 2) -
-                    ((cgi.SCR_MeasureFontString(hud_temp.table_rows[r].table_cells[i].text, scale).x) / 2);
+                    ((CG_MeasureFontString(hud_temp.table_rows[r].table_cells[i].text, scale).x) / 2);
             }
             // right align
             else if (i != 0)
             {
-                x_offset = (hud_temp.column_widths[i] - cgi.SCR_MeasureFontString(hud_temp.table_rows[r].table_cells[i].text, scale).x);
+                x_offset = (hud_temp.column_widths[i] - CG_MeasureFontString(hud_temp.table_rows[r].table_cells[i].text, scale).x);
             }
 
             //CG_DrawString(x + x_offset, ry, scale, hud_temp.table_rows[r].table_cells[i].text, r == 0, true);
@@ -1490,7 +1673,7 @@ static void CG_ExecuteLayoutString (const char *s, vrect_t hud_vrect, vrect_t hu
                 {
                     token = cgi.Localize(token, nullptr, 0);
                     Q_strlcpy(hud_temp.table_rows[0].table_cells[i].text, token, sizeof(hud_temp.table_rows[0].table_cells[i].text));
-                    hud_temp.column_widths[i] = max(hud_temp.column_widths[i], (size_t) cgi.SCR_MeasureFontString(hud_temp.table_rows[0].table_cells[i].text, scale).x);
+                    hud_temp.column_widths[i] = max(hud_temp.column_widths[i], (size_t) CG_MeasureFontString(hud_temp.table_rows[0].table_cells[i].text, scale).x);
                 }
             }
         }
@@ -1517,7 +1700,7 @@ static void CG_ExecuteLayoutString (const char *s, vrect_t hud_vrect, vrect_t hu
                 if (!skip_depth)
                 {
                     Q_strlcpy(row.table_cells[i].text, token, sizeof(row.table_cells[i].text));
-                    hud_temp.column_widths[i] = max(hud_temp.column_widths[i], (size_t) cgi.SCR_MeasureFontString(row.table_cells[i].text, scale).x);
+                    hud_temp.column_widths[i] = max(hud_temp.column_widths[i], (size_t) CG_MeasureFontString(row.table_cells[i].text, scale).x);
                 }
             }
             
@@ -1727,6 +1910,9 @@ void CG_DrawHUD (int32_t isplit, const cg_server_data_t *data, vrect_t hud_vrect
         return;
     }
 
+    hud_scales[isplit] = scale;
+    CG_CheckFontMeasures();
+
     // draw HUD
     if (!cl_skipHud->integer && !(ps->stats[STAT_LAYOUTS] & LAYOUTS_HIDE_HUD))
         CG_ExecuteLayoutString(cgi.get_configstring(CS_STATUSBAR), hud_vrect, hud_safe, scale, playernum, ps);
@@ -1777,4 +1963,6 @@ void CG_InitScreen()
     ui_acc_alttypeface = cgi.cvar("ui_acc_alttypeface", "0", CVAR_NOFLAGS);
 
     hud_data = {};
+    hud_scales = {};
+    CG_ClearFontMeasures();
 }
\ No newline at end of file
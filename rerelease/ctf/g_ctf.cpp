@@ -153,7 +153,8 @@ static void loc_buildboxpoints(vec3_t (&p)[8], const vec3_t &org, const vec3_t &
 	p[7][1] -= maxs[1];
 }
 
-static bool loc_CanSee(edict_t *targ, edict_t *inflictor)
+// Sarah: no longer static, the shared player visibility uses it too
+bool loc_CanSee(edict_t *targ, edict_t *inflictor, int32_t *num_traces)
 {
 	trace_t trace;
 	vec3_t	targpoints[8];
@@ -172,6 +173,10 @@ static bool loc_CanSee(edict_t *targ, edict_t *inflictor)
 	for (i = 0; i < 8; i++)
 	{
 		trace = gi.traceline(viewpoint, targpoints[i], inflictor, MASK_SOLID);
+
+		if (num_traces)
+			(*num_traces)++;
+
 		if (trace.fraction == 1.0f)
 			return true;
 	}
@@ -182,9 +187,24 @@ static bool loc_CanSee(edict_t *targ, edict_t *inflictor)
 
 /*--------------------------------------------------------------------------*/
 
+// Sarah: flag states from the last frame they were worked out on; anything that moves a
+// flag between base, carrier and dropped calls CTFFlagStateChanged so players later in
+// the same frame don't get the old state
+static struct
+{
+	gtime_t time = -1_ms;
+	int32_t p1, p2;
+} ctf_flag_pics;
+
+void CTFFlagStateChanged()
+{
+	ctf_flag_pics.time = -1_ms;
+}
+
 void CTFSpawn()
 {
 	memset(&ctfgame, 0, sizeof(ctfgame));
+	ctf_flag_pics.time = -1_ms;
 	CTFSetupTechSpawn();
 
 	if (competition->integer > 1)
@@ -405,7 +425,7 @@ edict_t *SelectCTFSpawnPoint(edict_t *ent, bool force_spawn)
 		return result.spot;
 	}
 
-	std::shuffle(spawn_points.begin(), spawn_points.end(), mt_rand);
+	std::shuffle(spawn_points.begin(), spawn_points.end(), rng_gameplay);
 
 	for (auto &point : spawn_points)
 		if (SpawnPointClear(point))
@@ -616,6 +636,8 @@ void CTFResetFlag(int ctf_team)
 		return;
 	}
 
+	CTFFlagStateChanged();
+
 	ent = nullptr;
 	while ((ent = G_FindByString<&edict_t::classname>(ent, c)) != nullptr)
 	{
@@ -626,7 +648,7 @@ void CTFResetFlag(int ctf_team)
 			ent->svflags &= ~SVF_NOCLIENT;
 			ent->solid = SOLID_TRIGGER;
 			gi.linkentity(ent);
-			ent->s.event = EV_ITEM_RESPAWN;
+			G_SetEvent(ent, EV_ITEM_RESPAWN);
 		}
 	}
 }
@@ -643,6 +665,8 @@ bool CTFPickup_Flag(edict_t *ent, edict_t *other)
 	edict_t	*player;
 	item_id_t flag_item, enemy_flag_item;
 
+	CTFFlagStateChanged();
+
 	// figure out what team this flag is
 	if (ent->item->id == IT_FLAG1)
 		ctf_team = CTF_TEAM1;
@@ -792,6 +816,8 @@ void CTFDeadDropFlag(edict_t *self)
 {
 	edict_t *dropped = nullptr;
 
+	CTFFlagStateChanged();
+
 	if (self->client->pers.inventory[IT_FLAG1])
 	{
 		dropped = Drop_Item(self, GetItemByIndex(IT_FLAG1));
@@ -846,6 +872,7 @@ THINK(CTFFlagSetup) (edict_t *ent) -> void
 	ent->movetype = MOVETYPE_TOSS;
 	ent->touch = Touch_Item;
 	ent->s.frame = 173;
+	CTFFlagStateChanged();
 
 	dest = ent->s.origin + vec3_t { 0, 0, -128 };
 
@@ -951,9 +978,12 @@ static void CTFSetIDView(edict_t *ent)
 	float	 bd = 0, d;
 
 	// only check every few frames
-	if (level.time - ent->client->resp.lastidtime < 250_ms)
+	// Sarah: on the same frames for every client, so they can share visibility results
+	gtime_t id_time = gtime_t::from_ms(level.time.milliseconds() - (level.time.milliseconds() % 250));
+
+	if (ent->client->resp.lastidtime == id_time)
 		return;
-	ent->client->resp.lastidtime = level.time;
+	ent->client->resp.lastidtime = id_time;
 
 	ent->client->ps.stats[STAT_CTF_ID_VIEW] = 0;
 	ent->client->ps.stats[STAT_CTF_ID_VIEW_COLOR] = 0;
@@ -987,7 +1017,7 @@ static void CTFSetIDView(edict_t *ent)
 		if (ent->client->resp.ctf_team == who->client->resp.ctf_team)
 			continue;
 
-		if (d > bd && loc_CanSee(ent, who))
+		if (d > bd && G_PlayerCanSee(ent, who))
 		{
 			bd = d;
 			best = who;
@@ -1054,19 +1084,41 @@ void SetCTFStats(edict_t *ent)
 	}
 
 	// tech icon
-	i = 0;
-	ent->client->ps.stats[STAT_CTF_TECH] = 0;
-	for (; i < q_countof(tech_ids); i++)
+	// Sarah: only when the inventory changed, see G_SetStats
+	client_stats_cache_t &cache = ent->client->stats_cache;
+
+	if (cache.changed || g_validate_stats->integer)
 	{
-		if (ent->client->pers.inventory[tech_ids[i]])
+		int16_t tech_icon = 0;
+
+		for (i = 0; i < q_countof(tech_ids); i++)
 		{
-			ent->client->ps.stats[STAT_CTF_TECH] = gi.imageindex(GetItemByIndex(tech_ids[i])->icon);
-			break;
+			if (ent->client->pers.inventory[tech_ids[i]])
+			{
+				tech_icon = gi.imageindex(GetItemByIndex(tech_ids[i])->icon);
+				break;
+			}
 		}
+
+		if (!cache.changed && tech_icon != cache.ctf_tech_icon)
+			gi.Com_PrintFmt("SetCTFStats: cached tech icon for {} doesn't match a full recompute\n", *ent);
+
+		cache.ctf_tech_icon = tech_icon;
 	}
 
-	if (ctf->integer)
+	ent->client->ps.stats[STAT_CTF_TECH] = cache.ctf_tech_icon;
+
+	// Sarah: the flag states are the same for everybody, so they're only worked out by the
+	// first player each frame
+	if (ctf->integer && ctf_flag_pics.time == level.time && !g_validate_stats->integer)
+	{
+		p1 = ctf_flag_pics.p1;
+		p2 = ctf_flag_pics.p2;
+	}
+	else if (ctf->integer)
 	{
+		bool flags_reset = false;
+
 		// figure out what icon to display for team logos
 		// three states:
 		//   flag at base
@@ -1098,6 +1150,7 @@ void SetCTFStats(edict_t *ent)
 					if (e == nullptr)
 					{
 						CTFResetFlag(CTF_TEAM1);
+						flags_reset = true;
 						gi.LocBroadcast_Print(PRINT_HIGH, "$g_flag_returned",
 							CTFTeamName(CTF_TEAM1));
 						gi.sound(ent, CHAN_RELIABLE | CHAN_NO_PHS_ADD | CHAN_AUX, gi.soundindex("ctf/flagret.wav"), 1, ATTN_NONE, 0);
@@ -1133,6 +1186,7 @@ void SetCTFStats(edict_t *ent)
 					if (e == nullptr)
 					{
 						CTFResetFlag(CTF_TEAM2);
+						flags_reset = true;
 						gi.LocBroadcast_Print(PRINT_HIGH, "$g_flag_returned",
 							CTFTeamName(CTF_TEAM2));
 						gi.sound(ent, CHAN_RELIABLE | CHAN_NO_PHS_ADD | CHAN_AUX, gi.soundindex("ctf/flagret.wav"), 1, ATTN_NONE, 0);
@@ -1143,6 +1197,17 @@ void SetCTFStats(edict_t *ent)
 				p2 = imageindex_i_ctf2d; // must be dropped
 		}
 
+		if (ctf_flag_pics.time == level.time && (p1 != ctf_flag_pics.p1 || p2 != ctf_flag_pics.p2))
+			gi.Com_PrintFmt("SetCTFStats: cached flag states for {} don't match a full recompute\n", *ent);
+
+		// the next player will see the flag back at base
+		ctf_flag_pics.time = flags_reset ? -1_ms : level.time;
+		ctf_flag_pics.p1 = p1;
+		ctf_flag_pics.p2 = p2;
+	}
+
+	if (ctf->integer)
+	{
 		ent->client->ps.stats[STAT_CTF_TEAM1_PIC] = p1;
 		ent->client->ps.stats[STAT_CTF_TEAM2_PIC] = p2;
 
@@ -1608,7 +1673,7 @@ constexpr size_t MAX_CTF_STAT_LENGTH = 1024;
 CTFScoreboardMessage
 ==================
 */
-void CTFScoreboardMessage(edict_t *ent, edict_t *killer)
+bool CTFScoreboardMessage(edict_t *ent, edict_t *killer, bool refresh)
 {
 	uint32_t   i, j, k, n;
 	uint32_t   sorted[2][MAX_CLIENTS];
@@ -1803,8 +1868,7 @@ void CTFScoreboardMessage(edict_t *ent, edict_t *killer)
 	if (level.intermissiontime)
 		fmt::format_to(std::back_inserter(string), FMT_STRING("ifgef {} yb -48 xv 0 loc_cstring2 0 \"$m_eou_press_button\" endif "), (level.intermission_server_frame + (5_sec).frames()));
 
-	gi.WriteByte(svc_layout);
-	gi.WriteString(string.c_str());
+	return G_WriteLayout(ent, string.c_str(), refresh);
 }
 
 /*------------------------------------------------------------------------*/
@@ -2282,8 +2346,6 @@ bool CTFBeginElection(edict_t *ent, elect_t type, const char *msg)
 	return true;
 }
 
-void DoRespawn(edict_t *ent);
-
 void CTFResetAllPlayers()
 {
 	uint32_t i;
@@ -2314,18 +2376,7 @@ void CTFResetAllPlayers()
 	CTFResetTech();
 	CTFResetFlags();
 
-	for (ent = g_edicts + 1, i = 1; i < globals.num_edicts; i++, ent++)
-	{
-		if (ent->inuse && !ent->client)
-		{
-			if (ent->solid == SOLID_NOT && ent->think == DoRespawn &&
-				ent->nextthink >= level.time)
-			{
-				ent->nextthink = 0_ms;
-				DoRespawn(ent);
-			}
-		}
-	}
+	G_RespawnAllItems();
 	if (ctfgame.match == MATCH_SETUP)
 		ctfgame.matchtime = level.time + gtime_t::from_min(matchsetuptime->value);
 }
@@ -3217,8 +3268,8 @@ TOUCH(old_teleporter_touch) (edict_t *self, edict_t *other, const trace_t &tr, b
 	other->client->ps.pmove.pm_flags |= PMF_TIME_TELEPORT;
 
 	// draw the teleport splash at source and on the player
-	self->enemy->s.event = EV_PLAYER_TELEPORT;
-	other->s.event = EV_PLAYER_TELEPORT;
+	G_SetEvent(self->enemy, EV_PLAYER_TELEPORT);
+	G_SetEvent(other, EV_PLAYER_TELEPORT);
 
 	// set angles
 	other->client->ps.pmove.delta_angles = dest->s.angles - other->client->resp.cmd_angles;
@@ -93,8 +93,10 @@ void		CTFCalcScores();
 void		CTFCalcRankings(std::array<uint32_t, MAX_CLIENTS> &player_ranks); // [Paril-KEX]
 void		CheckEndTDMLevel(); // [Paril-KEX]
 void		SetCTFStats(edict_t *ent);
+bool		loc_CanSee(edict_t *targ, edict_t *inflictor, int32_t *num_traces = nullptr);
 void		CTFDeadDropFlag(edict_t *self);
-void		CTFScoreboardMessage(edict_t *ent, edict_t *killer);
+void		CTFFlagStateChanged();
+bool		CTFScoreboardMessage(edict_t *ent, edict_t *killer, bool refresh = false);
 void		CTFTeam_f(edict_t *ent);
 void		CTFID_f(edict_t *ent);
 #ifndef KEX_Q2_GAME
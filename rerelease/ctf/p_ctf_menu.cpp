@@ -86,7 +86,8 @@ void PMenu_UpdateEntry(pmenu_t *entry, const char *text, int align, SelectFunc_t
 
 #include "../g_statusbar.h"
 
-void PMenu_Do_Update(edict_t *ent)
+// Sarah: returns false if it was a refresh that didn't need sending
+bool PMenu_Do_Update(edict_t *ent, bool refresh)
 {
 	int			i;
 	pmenu_t	*p;
@@ -98,7 +99,7 @@ void PMenu_Do_Update(edict_t *ent)
 	if (!ent->client->menu)
 	{
 		gi.Com_Print("warning:  ent has no menu\n");
-		return;
+		return false;
 	}
 
 	hnd = ent->client->menu;
@@ -158,8 +159,7 @@ void PMenu_Do_Update(edict_t *ent)
 		alt = false;
 	}
 
-	gi.WriteByte(svc_layout);
-	gi.WriteString(sb.sb.str().c_str());
+	return G_WriteLayout(ent, sb.sb.str().c_str(), refresh);
 }
 
 void PMenu_Update(edict_t *ent)
@@ -173,8 +173,8 @@ void PMenu_Update(edict_t *ent)
 	if (level.time - ent->client->menutime >= 1_sec)
 	{
 		// been a second or more since last update, update now
-		PMenu_Do_Update(ent);
-		gi.unicast(ent, true);
+		if (PMenu_Do_Update(ent, true))
+			gi.unicast(ent, true);
 		ent->client->menutime = level.time + 1_sec;
 		ent->client->menudirty = false;
 	}
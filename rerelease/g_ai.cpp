@@ -54,7 +54,7 @@ edict_t *AI_GetSightClient(edict_t *self)
     if (!num_visible)
         return nullptr;
 
-    return visible_players[irandom(num_visible)];
+    return visible_players[rng_ai.irandom(num_visible)];
 }
 
 //============================================================================
@@ -169,7 +169,8 @@ void ai_stand(edict_t *self, float dist)
         return;
     }
 
-    if (FindTarget(self))
+    // Sarah: under heavy AI load this can be put off to the next frame; see M_AllowIdleCheck
+    if (M_AllowIdleCheck(self) && FindTarget(self))
         return;
 
     if (level.time > self->monsterinfo.pausetime)
@@ -184,11 +185,11 @@ void ai_stand(edict_t *self, float dist)
         if (self->monsterinfo.idle_time)
         {
             self->monsterinfo.idle(self);
-            self->monsterinfo.idle_time = level.time + random_time(15_sec, 30_sec);
+            self->monsterinfo.idle_time = level.time + rng_ai.random_time(15_sec, 30_sec);
         }
         else
         {
-            self->monsterinfo.idle_time = level.time + random_time(15_sec);
+            self->monsterinfo.idle_time = level.time + rng_ai.random_time(15_sec);
         }
     }
 }
@@ -223,7 +224,8 @@ void ai_walk(edict_t *self, float dist)
     }
 
     // check for noticing a player
-    if (FindTarget(self))
+    // Sarah: unless heavy AI load puts it off to the next frame; see M_AllowIdleCheck
+    if (M_AllowIdleCheck(self) && FindTarget(self))
         return;
 
     if ((self->monsterinfo.search) && (level.time > self->monsterinfo.idle_time))
@@ -231,11 +233,11 @@ void ai_walk(edict_t *self, float dist)
         if (self->monsterinfo.idle_time)
         {
             self->monsterinfo.search(self);
-            self->monsterinfo.idle_time = level.time + random_time(15_sec, 30_sec);
+            self->monsterinfo.idle_time = level.time + rng_ai.random_time(15_sec, 30_sec);
         }
         else
         {
-            self->monsterinfo.idle_time = level.time + random_time(15_sec);
+            self->monsterinfo.idle_time = level.time + rng_ai.random_time(15_sec);
         }
     }
 }
@@ -414,7 +416,7 @@ bool visible(edict_t *self, edict_t *other, bool through_glass)
                 return false;
 
             // otherwise, throw in some randomness
-            if (frandom() > other->s.alpha)
+            if (rng_ai.frandom() > other->s.alpha)
                 return false;
         }
     }
@@ -578,8 +580,12 @@ static edict_t *AI_GetMonsterAlertedByPlayers(edict_t *self)
 // [Paril-KEX] per-player sounds
 static edict_t *AI_GetSoundClient(edict_t *self, bool direct)
 {
-    edict_t *best_sound = nullptr;
-    float best_distance = std::numeric_limits<float>::max();
+    // Sarah: the sounds are gathered first, then their distances worked out together
+    static vec3_batch_t<MAX_CLIENTS> origins;
+    static edict_t *sounds[MAX_CLIENTS];
+    alignas(16) static float dist[MAX_CLIENTS];
+
+    origins.clear();
 
     for (auto player : active_players())
     {
@@ -598,13 +604,22 @@ static edict_t *AI_GetSoundClient(edict_t *self, bool direct)
         if (!(time >= (level.time - FRAME_TIME_S)))
             continue;
 
-        // prefer the closest one we heard
-        float dist = (self->s.origin - sound->s.origin).length();
+        sounds[origins.count] = sound;
+        origins.push(sound->s.origin);
+    }
 
-        if (!best_sound || dist < best_distance)
+    vec3_batch_distance_squared(origins, self->s.origin, dist);
+
+    // prefer the closest one we heard
+    edict_t *best_sound = nullptr;
+    float best_distance = std::numeric_limits<float>::max();
+
+    for (size_t i = 0; i < origins.count; i++)
+    {
+        if (!best_sound || dist[i] < best_distance)
         {
-            best_distance = dist;
-            best_sound = sound;
+            best_distance = dist[i];
+            best_sound = sounds[i];
         }
     }
 
@@ -1036,7 +1051,7 @@ bool M_CheckAttack_Base(edict_t *self, float stand_ground_chance, float melee_ch
     }
 
     // PGM - go ahead and shoot every time if it's a info_notnull
-    if ((!self->enemy->client && self->enemy->solid == SOLID_NOT) || (frandom() < chance))
+    if ((!self->enemy->client && self->enemy->solid == SOLID_NOT) || (rng_ai.frandom() < chance))
     {
         self->monsterinfo.attack_state = AS_MISSILE;
         self->monsterinfo.attack_finished = level.time;
@@ -1067,12 +1082,12 @@ bool M_CheckAttack_Base(edict_t *self, float stand_ground_chance, float melee_ch
             {
                 monster_attack_state_t new_state = AS_STRAIGHT;
 
-                if (frandom() < strafe_chance)
+                if (rng_ai.frandom() < strafe_chance)
                     new_state = AS_SLIDING;
 
                 if (new_state != self->monsterinfo.attack_state)
                 {
-                    self->monsterinfo.strafe_check_time = level.time + random_time(1_sec, 3_sec);
+                    self->monsterinfo.strafe_check_time = level.time + rng_ai.random_time(1_sec, 3_sec);
                     self->monsterinfo.attack_state = new_state;
                 }
             }
@@ -1137,7 +1152,7 @@ void ai_run_missile(edict_t *self)
         if (self->monsterinfo.attack)
         {
             self->monsterinfo.attack(self);
-            self->monsterinfo.attack_finished = level.time + random_time(1.0_sec, 2.0_sec);
+            self->monsterinfo.attack_finished = level.time + rng_ai.random_time(1.0_sec, 2.0_sec);
         }
 
         // ROGUE
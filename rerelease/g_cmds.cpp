@@ -1368,7 +1368,7 @@ void Cmd_Wave_f(edict_t *ent)
 		{
 			if (ent == targ) continue;
 			if (!targ->client) continue;
-			if (!gi.inPVS(ent->s.origin, targ->s.origin, false)) continue;
+			if (!G_PlayerInPVS(ent, targ)) continue;
 
 			if (aiming_at && other_notify_msg)
 				gi.LocClient_Print(targ, PRINT_TTS, other_notify_msg, ent->client->pers.netname, aiming_at->client->pers.netname);
@@ -86,6 +86,16 @@ void Killed(edict_t *targ, edict_t *inflictor, edict_t *attacker, int damage, co
 	if (targ->health < -999)
 		targ->health = -999;
 
+	// Sarah: script event handlers
+	if (script_event_count[SCRIPT_EVENT_DEATH])
+	{
+		script_event_entity(SCRIPT_EVENT_DEATH, targ, attacker, damage);
+
+		// the handler may have removed it
+		if (!targ->inuse)
+			return;
+	}
+
 	// [Paril-KEX]
 	if ((targ->svflags & SVF_MONSTER) && targ->monsterinfo.aiflags & AI_MEDIC)
 	{
@@ -750,6 +760,16 @@ void T_Damage(edict_t *targ, edict_t *inflictor, edict_t *attacker, const vec3_t
 		if ((targ->flags & FL_IMMORTAL) && targ->health <= 0)
 			targ->health = 1;
 
+		// Sarah: script event handlers
+		if (script_event_count[SCRIPT_EVENT_DAMAGE])
+		{
+			script_event_entity(SCRIPT_EVENT_DAMAGE, targ, attacker, take);
+
+			// the handler may have removed it
+			if (!targ->inuse)
+				return;
+		}
+
 		// PGM - spheres need to know who to shoot at
 		if (client && client->owned_sphere)
 		{
@@ -772,6 +792,7 @@ void T_Damage(edict_t *targ, edict_t *inflictor, edict_t *attacker, const vec3_t
 			targ->monsterinfo.damage_from = point;
 			targ->monsterinfo.damage_mod = mod;
 			targ->monsterinfo.damage_knockback += knockback;
+			M_QueuePain(targ);
 			Killed(targ, inflictor, attacker, take, point, mod);
 			return;
 		}
@@ -805,6 +826,7 @@ void T_Damage(edict_t *targ, edict_t *inflictor, edict_t *attacker, const vec3_t
 			targ->monsterinfo.damage_from = point;
 			targ->monsterinfo.damage_mod = mod;
 			targ->monsterinfo.damage_knockback += knockback;
+			M_QueuePain(targ);
 		}
 
 		if (targ->monsterinfo.setskin)
@@ -2365,7 +2365,7 @@ again:
 		}
 
 		self->s.old_origin = self->s.origin;
-		self->s.event = EV_OTHER_TELEPORT;
+		G_SetEvent(self, EV_OTHER_TELEPORT);
 		gi.linkentity(self);
 
 		// Sarah: make teamchain teleport
@@ -2375,7 +2375,7 @@ again:
 			{
 				e->s.origin = self->s.origin + e->s.origin - origin;
 				e->s.old_origin = e->s.origin;
-				e->s.event = EV_OTHER_TELEPORT;
+				G_SetEvent(e, EV_OTHER_TELEPORT);
 				gi.linkentity(e);
 			}
 		}
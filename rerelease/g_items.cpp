@@ -119,6 +119,9 @@ gitem_t *FindItem(const char *pickup_name)
 
 //======================================================================
 
+// Sarah: the members of each item team, in chain order, keyed by the team master
+static std::unordered_map<const edict_t *, std::vector<edict_t *>> item_teams;
+
 THINK(DoRespawn) (edict_t *ent) -> void
 {
 	if (ent->team)
@@ -141,13 +144,19 @@ THINK(DoRespawn) (edict_t *ent) -> void
 			ent->solid = SOLID_NOT;
 			gi.linkentity(ent);
 
-			for (count = 0, ent = master; ent; ent = ent->chain, count++)
-				;
+			// Sarah: teams found at spawn time pick straight from their array
+			if (auto team = item_teams.find(master); team != item_teams.end())
+				ent = team->second[irandom(team->second.size())];
+			else
+			{
+				for (count = 0, ent = master; ent; ent = ent->chain, count++)
+					;
 
-			choice = irandom(count);
+				choice = irandom(count);
 
-			for (count = 0, ent = master; count < choice; ent = ent->chain, count++)
-				;
+				for (count = 0, ent = master; count < choice; ent = ent->chain, count++)
+					;
+			}
 		}
 	}
 
@@ -157,7 +166,7 @@ THINK(DoRespawn) (edict_t *ent) -> void
 	gi.linkentity(ent);
 
 	// send an effect
-	ent->s.event = EV_ITEM_RESPAWN;
+	G_SetEvent(ent, EV_ITEM_RESPAWN);
 
 	// ROGUE
 	if (g_dm_random_items->integer)
@@ -178,10 +187,50 @@ THINK(DoRespawn) (edict_t *ent) -> void
 	// ROGUE
 }
 
+// Sarah: pending item respawns live on a timing wheel instead of in think/nextthink.
+// Each slot is one server frame; a respawn further out than the wheel goes around
+// it until it's due. item_respawn_time is the saved copy, and an entry whose entity
+// no longer matches it (freed, reused or respawned early) is just dropped.
+constexpr size_t ITEM_RESPAWN_WHEEL_SIZE = 1024;
+
+struct item_respawn_entry_t
+{
+	edict_t *ent;
+	int32_t	 spawn_count;
+	gtime_t	 time;
+};
+
+static struct
+{
+	std::array<std::vector<item_respawn_entry_t>, ITEM_RESPAWN_WHEEL_SIZE> slots;
+	int64_t drained_frame;
+	size_t pending;
+
+	uint64_t scheduled, fired, stale;
+	size_t peak_pending;
+} item_respawns;
+
+// first frame at which level.time >= time
+static int64_t G_ItemRespawnFrame(gtime_t time)
+{
+	return (time.milliseconds() + gi.frame_time_ms - 1) / gi.frame_time_ms;
+}
+
+static void G_ScheduleItemRespawn(edict_t *ent, gtime_t time)
+{
+	ent->item_respawn_time = time;
+
+	int64_t frame = max(G_ItemRespawnFrame(time), item_respawns.drained_frame + 1);
+	item_respawns.slots[frame % ITEM_RESPAWN_WHEEL_SIZE].push_back({ ent, ent->spawn_count, time });
+	item_respawns.pending++;
+	item_respawns.scheduled++;
+	item_respawns.peak_pending = max(item_respawns.peak_pending, item_respawns.pending);
+}
+
 void SetRespawn(edict_t *ent, gtime_t delay, bool hide_self)
 {
 	// already respawning
-	if (ent->think == DoRespawn && ent->nextthink >= level.time)
+	if (ent->item_respawn_time && ent->item_respawn_time >= level.time)
 		return;
 
 	ent->flags |= FL_RESPAWN;
@@ -193,8 +242,133 @@ void SetRespawn(edict_t *ent, gtime_t delay, bool hide_self)
 		gi.linkentity(ent);
 	}
 
-	ent->nextthink = level.time + delay;
-	ent->think = DoRespawn;
+	// whatever it was going to do, it's respawning instead
+	ent->nextthink = 0_ms;
+	ent->think = nullptr;
+
+	G_ScheduleItemRespawn(ent, level.time + delay);
+}
+
+static bool G_ItemRespawnValid(const item_respawn_entry_t &entry)
+{
+	return entry.ent->inuse && entry.ent->spawn_count == entry.spawn_count && entry.ent->item_respawn_time == entry.time;
+}
+
+static void G_DrainItemRespawnSlot(std::vector<item_respawn_entry_t> &slot, bool fire_all)
+{
+	for (size_t i = 0; i < slot.size(); )
+	{
+		item_respawn_entry_t entry = slot[i];
+
+		if (!G_ItemRespawnValid(entry))
+			item_respawns.stale++;
+		// not this time around
+		else if (!fire_all && entry.time > level.time)
+		{
+			i++;
+			continue;
+		}
+
+		slot[i] = slot.back();
+		slot.pop_back();
+		item_respawns.pending--;
+
+		if (G_ItemRespawnValid(entry))
+		{
+			item_respawns.fired++;
+			entry.ent->item_respawn_time = 0_ms;
+			DoRespawn(entry.ent);
+		}
+	}
+}
+
+// called once per frame, before entities run
+void G_RunItemRespawns()
+{
+	int64_t frame = level.time.milliseconds() / gi.frame_time_ms;
+
+	if (frame <= item_respawns.drained_frame)
+		return;
+
+	// skipped a full turn; every slot is due
+	int64_t first = max(item_respawns.drained_frame + 1, frame - (int64_t) ITEM_RESPAWN_WHEEL_SIZE + 1);
+	item_respawns.drained_frame = frame;
+
+	for (int64_t f = first; f <= frame; f++)
+		G_DrainItemRespawnSlot(item_respawns.slots[f % ITEM_RESPAWN_WHEEL_SIZE], false);
+}
+
+// respawn everything that's waiting to, right now
+void G_RespawnAllItems()
+{
+	for (auto &slot : item_respawns.slots)
+		G_DrainItemRespawnSlot(slot, true);
+}
+
+// time until the item comes back, or zero if it isn't waiting to
+gtime_t G_ItemRespawnPending(const edict_t *ent)
+{
+	if (!ent->item_respawn_time || ent->item_respawn_time < level.time)
+		return 0_ms;
+
+	return ent->item_respawn_time - level.time;
+}
+
+void G_BuildItemTeams()
+{
+	item_teams.clear();
+
+	for (uint32_t i = game.maxclients + 1; i < globals.num_edicts; i++)
+	{
+		edict_t *master = &g_edicts[i];
+
+		if (!master->inuse || !master->item || !master->team || master->teammaster != master)
+			continue;
+
+		auto &members = item_teams[master];
+
+		// members that haven't dropped to the floor yet are still on teamchain
+		for (edict_t *e = master; e; e = e->chain ? e->chain : e->teamchain)
+			members.push_back(e);
+	}
+}
+
+// rebuild everything from the entities; level.time must already be set
+void G_ResetItemRespawns()
+{
+	for (auto &slot : item_respawns.slots)
+		slot.clear();
+
+	item_respawns.pending = 0;
+	item_respawns.drained_frame = level.time.milliseconds() / gi.frame_time_ms;
+
+	G_BuildItemTeams();
+
+	for (uint32_t i = game.maxclients + 1; i < globals.num_edicts; i++)
+	{
+		edict_t *ent = &g_edicts[i];
+
+		if (!ent->inuse)
+			continue;
+
+		// saved from before the wheel
+		if (ent->think == DoRespawn && ent->nextthink)
+		{
+			ent->item_respawn_time = max(ent->nextthink, level.time);
+			ent->think = nullptr;
+			ent->nextthink = 0_ms;
+		}
+
+		if (ent->item_respawn_time)
+			G_ScheduleItemRespawn(ent, ent->item_respawn_time);
+	}
+}
+
+void G_ItemRespawnReport()
+{
+	gi.Com_PrintFmt("pending={} peak_pending={} scheduled={} fired={} stale={} teams={}\n",
+		item_respawns.pending, item_respawns.peak_pending, item_respawns.scheduled, item_respawns.fired,
+		item_respawns.stale, item_teams.size());
 }
 
 //======================================================================
@@ -971,6 +1145,16 @@ TOUCH(Touch_Item) (edict_t *ent, edict_t *other, const trace_t &tr, bool other_t
 			if (ent->message)
 				G_PrintActivationMessage(ent, other, false);
 		}
+
+		// Sarah: script event handlers
+		if (script_event_count[SCRIPT_EVENT_PICKUP])
+		{
+			script_event_entity(SCRIPT_EVENT_PICKUP, ent, other, 0);
+
+			// the handler may have removed it
+			if (!ent->inuse)
+				return;
+		}
 	}
 
 	if (!(ent->spawnflags & SPAWNFLAG_ITEM_TARGETS_USED))
@@ -1177,8 +1361,9 @@ THINK(droptofloor) (edict_t *ent) -> void
 
 		if (ent == ent->teammaster)
 		{
-			ent->nextthink = level.time + 10_hz;
-			ent->think = DoRespawn;
+			ent->nextthink = 0_ms;
+			ent->think = nullptr;
+			G_ScheduleItemRespawn(ent, level.time + 10_hz);
 		}
 	}
 
@@ -1727,6 +1727,11 @@ struct monsterinfo_t
 
 	gtime_t jump_time;
 
+	// Sarah: the AI tick budget skipped this monster's last idle target
+	// check, so the next one goes ahead regardless; deliberately not saved,
+	// it only spreads work out
+	bool idle_check_deferred;
+
 	// NOTE: if adding new elements, make sure to add them
 	// in g_save.cpp too!
 };
@@ -1781,37 +1786,195 @@ extern spawn_temp_t	  st;
 
 extern edict_t *g_edicts;
 
-#include <random>
-extern std::mt19937 mt_rand;
+// Sarah: random numbers come from xoshiro128**, which is a lot smaller and faster than
+// mt19937. They're split into independent streams so that adding or removing calls in one
+// (say, a new gib effect) doesn't change the sequence any other sees, which keeps replays
+// and benchmarks repeatable. The free functions below all use the gameplay stream.
+struct rng_stream_t
+{
+	using result_type = uint32_t;
+
+	std::array<uint32_t, 4> s;
+
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return UINT32_MAX; }
+
+	void seed(uint64_t seed);
+
+	inline result_type operator()()
+	{
+		const uint32_t result = rotl(s[1] * 5, 7) * 9;
+		const uint32_t t = s[1] << 9;
+
+		s[2] ^= s[0];
+		s[3] ^= s[1];
+		s[1] ^= s[2];
+		s[0] ^= s[3];
+		s[2] ^= t;
+		s[3] = rotl(s[3], 11);
+
+		return result;
+	}
+
+	// uniform int [0, range), without modulo bias
+	inline uint32_t bounded(uint32_t range)
+	{
+		uint64_t m = (uint64_t) (*this)() * range;
+		uint32_t l = (uint32_t) m;
+
+		if (l < range)
+		{
+			uint32_t t = (0u - range) % range;
+
+			while (l < t)
+			{
+				m = (uint64_t) (*this)() * range;
+				l = (uint32_t) m;
+			}
+		}
+
+		return (uint32_t) (m >> 32);
+	}
+
+	// uniform float [0, 1)
+	[[nodiscard]] inline float frandom()
+	{
+		return ((*this)() >> 8) * 0x1.0p-24f;
+	}
+
+	// uniform float [min_inclusive, max_exclusive)
+	[[nodiscard]] inline float frandom(float min_inclusive, float max_exclusive)
+	{
+		return min_inclusive + (max_exclusive - min_inclusive) * frandom();
+	}
+
+	// uniform float [0, max_exclusive)
+	[[nodiscard]] inline float frandom(float max_exclusive)
+	{
+		return max_exclusive * frandom();
+	}
+
+	// uniform float [-1, 1)
+	[[nodiscard]] inline float crandom()
+	{
+		return frandom(-1.f, 1.f);
+	}
+
+	// uniform float (-1, 1)
+	[[nodiscard]] inline float crandom_open()
+	{
+		return frandom(std::nextafterf(-1.f, 0.f), 1.f);
+	}
+
+	// uniform int [min, max)
+	// always returns min if min == (max - 1)
+	// undefined behavior if min > (max - 1)
+	[[nodiscard]] inline int32_t irandom(int32_t min_inclusive, int32_t max_exclusive)
+	{
+		if (min_inclusive == max_exclusive - 1)
+			return min_inclusive;
+
+		return min_inclusive + (int32_t) bounded((uint32_t) (max_exclusive - min_inclusive));
+	}
+
+	// uniform int [0, max)
+	// always returns 0 if max <= 0
+	[[nodiscard]] inline int32_t irandom(int32_t max_exclusive)
+	{
+		if (max_exclusive <= 0)
+			return 0;
+
+		return irandom(0, max_exclusive);
+	}
+
+	// flip a coin
+	[[nodiscard]] inline bool brandom()
+	{
+		return irandom(2) == 0;
+	}
+
+	// uniform time [min_inclusive, max_inclusive]; the range is expected to fit in 32 bits
+	[[nodiscard]] inline gtime_t random_time(gtime_t min_inclusive, gtime_t max_inclusive)
+	{
+		uint32_t range = (uint32_t) (max_inclusive - min_inclusive).milliseconds();
+		return min_inclusive + gtime_t::from_ms(range == UINT32_MAX ? (*this)() : bounded(range + 1));
+	}
+
+	// uniform time [0, max_inclusive]
+	[[nodiscard]] inline gtime_t random_time(gtime_t max_inclusive)
+	{
+		return random_time(0_ms, max_inclusive);
+	}
+
+	// batches, for spread patterns and the like
+	inline void frandom_fill(float *out, size_t count)
+	{
+		for (size_t i = 0; i < count; i++)
+			out[i] = frandom();
+	}
+
+	inline void crandom_fill(float *out, size_t count)
+	{
+		for (size_t i = 0; i < count; i++)
+			out[i] = crandom();
+	}
+
+private:
+	static constexpr uint32_t rotl(uint32_t x, int k)
+	{
+		return (x << k) | (x >> (32 - k));
+	}
+};
+
+enum rng_stream_id_t : uint8_t
+{
+	// anything that changes the outcome of the game
+	RNG_GAMEPLAY,
+	// monster AI decisions
+	RNG_AI,
+	// purely cosmetic; gibs, debris, etc
+	RNG_EFFECTS,
+
+	RNG_TOTAL
+};
+
+extern std::array<rng_stream_t, RNG_TOTAL> rng_streams;
+extern const char *const rng_stream_names[RNG_TOTAL];
+
+inline rng_stream_t &rng_gameplay = rng_streams[RNG_GAMEPLAY];
+inline rng_stream_t &rng_ai = rng_streams[RNG_AI];
+inline rng_stream_t &rng_effects = rng_streams[RNG_EFFECTS];
+
+void G_SeedRandom(uint64_t seed);
 
 // uniform float [0, 1)
 [[nodiscard]] inline float frandom()
 {
-	return std::uniform_real_distribution<float>()(mt_rand);
+	return rng_gameplay.frandom();
 }
 
 // uniform float [min_inclusive, max_exclusive)
 [[nodiscard]] inline float frandom(float min_inclusive, float max_exclusive)
 {
-	return std::uniform_real_distribution<float>(min_inclusive, max_exclusive)(mt_rand);
+	return rng_gameplay.frandom(min_inclusive, max_exclusive);
 }
 
 // uniform float [0, max_exclusive)
 [[nodiscard]] inline float frandom(float max_exclusive)
 {
-	return std::uniform_real_distribution<float>(0, max_exclusive)(mt_rand);
+	return rng_gameplay.frandom(max_exclusive);
 }
 
 // uniform time [min_inclusive, max_exclusive)
 [[nodiscard]] inline gtime_t random_time(gtime_t min_inclusive, gtime_t max_exclusive)
 {
-	return gtime_t::from_ms(std::uniform_int_distribution<int64_t>(min_inclusive.milliseconds(), max_exclusive.milliseconds())(mt_rand));
+	return rng_gameplay.random_time(min_inclusive, max_exclusive);
 }
 
 // uniform time [0, max_exclusive)
 [[nodiscard]] inline gtime_t random_time(gtime_t max_exclusive)
 {
-	return gtime_t::from_ms(std::uniform_int_distribution<int64_t>(0, max_exclusive.milliseconds())(mt_rand));
+	return rng_gameplay.random_time(0_ms, max_exclusive);
 }
 
 // uniform float [-1, 1)
@@ -1819,19 +1982,19 @@ extern std::mt19937 mt_rand;
 // to match vanilla behavior
 [[nodiscard]] inline float crandom()
 {
-	return std::uniform_real_distribution<float>(-1.f, 1.f)(mt_rand);
+	return rng_gameplay.crandom();
 }
 
 // uniform float (-1, 1)
 [[nodiscard]] inline float crandom_open()
 {
-	return std::uniform_real_distribution<float>(std::nextafterf(-1.f, 0.f), 1.f)(mt_rand);
+	return rng_gameplay.crandom_open();
 }
 
 // raw unsigned int32 value from random
 [[nodiscard]] inline uint32_t irandom()
 {
-	return mt_rand();
+	return rng_gameplay();
 }
 
 // uniform int [min, max)
@@ -1839,10 +2002,7 @@ extern std::mt19937 mt_rand;
 // undefined behavior if min > (max - 1)
 [[nodiscard]] inline int32_t irandom(int32_t min_inclusive, int32_t max_exclusive)
 {
-	if (min_inclusive == max_exclusive - 1)
-		return min_inclusive;
-
-	return std::uniform_int_distribution<int32_t>(min_inclusive, max_exclusive - 1)(mt_rand);
+	return rng_gameplay.irandom(min_inclusive, max_exclusive);
 }
 
 // uniform int [0, max)
@@ -1957,6 +2117,14 @@ extern cvar_t* g_start_items;
 extern cvar_t* g_map_list;
 extern cvar_t* g_map_list_shuffle;
 extern cvar_t *g_lag_compensation;
+extern cvar_t *g_script_memory_limit;
+extern cvar_t *g_validate_stats;
+extern cvar_t *g_rng_seed;
+extern cvar_t *g_log_rate;
+extern cvar_t *g_log_repeat_window;
+extern cvar_t *g_log_file;
+extern cvar_t *g_validate_events;
+extern cvar_t *g_ai_tick_budget;
 
 // ROGUE
 extern cvar_t *gamerules;
@@ -2020,6 +2188,12 @@ gitem_t	*FindItem(const char *pickup_name);
 gitem_t	*FindItemByClassname(const char *classname);
 edict_t	*Drop_Item(edict_t *ent, gitem_t *item);
 void	  SetRespawn(edict_t *ent, gtime_t delay, bool hide_self = true);
+void	  G_RunItemRespawns();
+void	  G_RespawnAllItems();
+gtime_t	  G_ItemRespawnPending(const edict_t *ent);
+void	  G_BuildItemTeams();
+void	  G_ResetItemRespawns();
+void	  G_ItemRespawnReport();
 void	  ChangeWeapon(edict_t *ent);
 void	  SpawnItem(edict_t *ent, gitem_t *item);
 void	  Think_Weapon(edict_t *ent);
@@ -2066,6 +2240,25 @@ edict_t *G_PickTarget(const char *targetname);
 // Sarah: added
 void G_Kill(edict_t* ent);
 
+// Sarah: shared player-to-player visibility
+bool G_PlayerInPVS(edict_t *a, edict_t *b);
+bool G_PlayerCanSee(edict_t *targ, edict_t *from);
+void G_InvalidatePlayerVisibility();
+void G_PlayerVisibilityFrame();
+void G_PlayerVisibilityReport();
+
+// Sarah: configstring writes
+void G_InstallConfigStrings();
+void G_FlushConfigStrings();
+void G_ConfigStringReport();
+void G_SetEvent(edict_t *ent, entity_event_t event);
+void G_ClearEvents();
+void G_ResetEvents();
+void G_InstallLogging();
+void G_FlushLog();
+void G_ShutdownLogging();
+void G_LogReport();
+
 void	 G_UseTargets(edict_t *ent, edict_t *activator);
 void	 G_PrintActivationMessage(edict_t *ent, edict_t *activator, bool coop_global);
 void	 G_SetMovedir(vec3_t &angles, vec3_t &movedir);
@@ -2104,11 +2297,28 @@ char *ED_NewString(char *string);
 // Sarah: prototype added, used by script
 void ED_ParseField(const char* key, const char* value, edict_t* ent);
 
+// Sarah: an entity key that has been looked up and had its value converted ahead of time,
+// so it can be applied to any number of entities without parsing it again
+struct parselist_t;
+
+struct prepared_field_t
+{
+	const parselist_t* field;
+	// Original value, for keys with custom parse functions that have to run for every entity
+	const char* value;
+	// Value converted to the member's type, for keys that are copied directly to the entity
+	uint8_t data[16];
+};
+
+bool ED_PrepareField(const char* key, const char* value, prepared_field_t& prepared);
+void ED_ApplyPreparedField(const prepared_field_t& prepared, edict_t* ent);
+
 //
 // g_target.c
 //
 void target_laser_think(edict_t *self);
 void target_laser_off(edict_t *self);
+void target_laser_report();
 
 constexpr spawnflags_t SPAWNFLAG_LASER_ON = 0x0001_spawnflag;
 constexpr spawnflags_t SPAWNFLAG_LASER_RED = 0x0002_spawnflag;
@@ -2223,6 +2433,13 @@ bool M_CheckAttack(edict_t *self);
 void M_CheckGround(edict_t *ent, contents_t mask);
 void monster_use(edict_t *self, edict_t *other, edict_t *activator);
 void M_ProcessPain(edict_t *e);
+void M_BeginAIFrame();
+void M_ResetAISchedule();
+bool M_AllowIdleCheck(edict_t *self);
+void M_AIScheduleReport();
+void M_QueuePain(edict_t *e);
+void M_ProcessPainQueue();
+void M_ClearPainQueue();
 bool M_ShouldReactToPain(edict_t *self, const mod_t &mod);
 void M_SetAnimation(edict_t *self, const save_mmove_t &move, bool instant = true);
 bool M_AllowSpawn( edict_t * self );
@@ -2456,11 +2673,16 @@ void G_UnLagCompensate();
 //
 void MoveClientToIntermission(edict_t *client);
 void G_SetStats(edict_t *ent);
+void G_InvalidateStatsCache();
+void G_StatsCacheReport();
 void G_SetCoopStats(edict_t *ent);
 void G_SetSpectatorStats(edict_t *ent);
 void G_CheckChaseStats(edict_t *ent);
 void ValidateSelectedItem(edict_t *ent);
-void DeathmatchScoreboardMessage(edict_t *client, edict_t *killer);
+bool DeathmatchScoreboardMessage(edict_t *client, edict_t *killer, bool refresh = false);
+bool G_WriteLayout(edict_t *ent, const char *layout, bool refresh);
+void G_InvalidateLayout(edict_t *ent);
+void G_LayoutReport();
 void G_ReportMatchDetails(bool is_end);
 
 //
@@ -2515,6 +2737,10 @@ constexpr float sv_friction = 6;
 constexpr float sv_waterfriction = 1;
 
 void G_RunEntity(edict_t *ent);
+bool G_EntityCanSleep(const edict_t *ent);
+bool G_SleepEntity(edict_t *ent);
+void G_SleepFrame();
+void G_SleepReport();
 bool SV_RunThink(edict_t *ent);
 void SV_AddRotationalFriction(edict_t *ent);
 void SV_AddGravity(edict_t *ent);
@@ -2636,6 +2862,21 @@ void Hunter_Launch(edict_t *self);
 //
 void	 InitGameRules();
 item_id_t DoRandomRespawn(edict_t *ent);
+
+// Sarah: what a g_dm_random_items respawn can turn an item into
+struct random_respawn_pool_t
+{
+	enum kind_t : uint8_t
+	{
+		UNIFORM, // every item equally likely
+		WEIGHTED // item i is picked if frandom() < thresholds[i], checked in order
+	} kind;
+
+	std::vector<item_id_t> items;
+	std::vector<float> thresholds;
+};
+
+const random_respawn_pool_t *GetRandomRespawnPool(item_id_t id);
 void	 PrecacheForRandomRespawn();
 bool	 Tag_PickupToken(edict_t *ent, edict_t *other);
 void	 Tag_DropToken(edict_t *ent, gitem_t *item);
@@ -2674,9 +2915,39 @@ constexpr spawnflags_t SPAWNFLAG_LANDMARK_KEEP_Z = 1_spawnflag;
 
 void script_init();
 void script_load(const char* mapname);
+void script_unload();
+void script_release_level_strings();
+void script_prefetch(const char* changemap);
+void script_shutdown();
 
-void script_get_variables(std::unordered_map<std::string, std::string>& variables, bool crosslevel = false);
-void script_set_variables(std::unordered_map<std::string, std::string>& variables, bool crosslevel = false);
+namespace Json
+{
+	class Value;
+}
+
+void script_write_variables(Json::Value& json, bool persistent = false);
+void script_read_variables(const Json::Value& json, bool persistent = false);
+
+// Events scripts can register handlers for with script.on
+enum script_event_t
+{
+	SCRIPT_EVENT_SPAWN,
+	SCRIPT_EVENT_DAMAGE,
+	SCRIPT_EVENT_DEATH,
+	SCRIPT_EVENT_PICKUP,
+	SCRIPT_EVENT_FRAME,
+	SCRIPT_EVENT_TOTAL
+};
+
+// Number of handlers registered for each event; check it before dispatching so
+// events nobody is listening for cost nothing more than the check
+extern int32_t script_event_count[SCRIPT_EVENT_TOTAL];
+
+void script_event_entity(script_event_t event, edict_t* ent, edict_t* other, int32_t amount);
+void script_event_frame();
+
+void script_memory_report();
+void script_prefetch_report();
 
 //============================================================================
 
@@ -2845,6 +3116,40 @@ constexpr gtime_t COOP_DAMAGE_RESPAWN_TIME = 2000_ms;
 // time after firing that we can't respawn on a player for
 constexpr gtime_t COOP_DAMAGE_FIRING_TIME = 2500_ms;
 
+// Sarah: player stats that only depend on the inventory and a few other things the
+// player controls, so G_SetStats only works them out again when one of those changes.
+// Not saved; image indices can change between levels, so the generation invalidates it.
+struct client_stats_cache_t
+{
+	uint32_t generation;
+	// recomputed this frame
+	bool changed;
+
+	// inputs
+	std::array<int32_t, IT_TOTAL> inventory;
+	gitem_t *weapon, *newweapon;
+	bool power_armor, flashlight;
+	item_id_t selected_item;
+	handedness_t hand;
+	bool infinite_ammo;
+
+	// outputs
+	int16_t weapons_owned_1, weapons_owned_2;
+	int16_t active_wheel_weapon, active_weapon;
+	int16_t ammo_icon, ammo;
+	std::array<int16_t, NUM_AMMO_STATS> ammo_info;
+	std::array<int16_t, NUM_POWERUP_STATS> powerup_info;
+	item_id_t power_armor_type;
+	int16_t power_armor_icon, power_armor_cells;
+	item_id_t armor_index;
+	int16_t armor_icon, armor_count;
+	int16_t selected_icon;
+	int16_t weapon_icon;
+	size_t num_keys;
+	std::array<int16_t, IT_TOTAL> key_icons;
+	int16_t ctf_tech_icon;
+};
+
 // this structure is cleared on each PutClientInServer(),
 // except for 'client->pers'
 struct gclient_t
@@ -3033,6 +3338,20 @@ struct gclient_t
 	gtime_t	 last_attacker_time;
 	// saved - for coop; last time we were in a firing state
 	gtime_t	 last_firing_time;
+
+	// Sarah: not saved
+	client_stats_cache_t stats_cache;
+
+	// Sarah: the last layout this client was sent, so refreshes that haven't
+	// changed can be skipped; not saved
+	struct {
+		bool valid;
+		uint64_t hash;
+		size_t length;
+		gtime_t time;
+		uint32_t skipped;
+		uint64_t bytes_saved;
+	} layout_sent;
 };
 
 // ==========================================
@@ -3183,6 +3502,9 @@ struct edict_t
 
 	gtime_t teleport_time;
 
+	// Sarah: when a picked up item comes back; see SetRespawn
+	gtime_t item_respawn_time;
+
 	contents_t	  watertype;
 	water_level_t waterlevel;
 
@@ -3265,6 +3587,23 @@ struct edict_t
 	const char* script_function;
 	const char* script_arg;
 
+	// Sarah: target_laser beam from the last trace, so it can skip tracing again when
+	// nothing could have changed. This is deliberately not saved; it starts out invalid
+	// after loading so the first think does a full trace.
+	struct {
+		bool valid;
+		// the beam went through something it could damage
+		bool damageable;
+		vec3_t start;
+		vec3_t dir;
+		// combined hash of every solid entity in the beam's bounding box
+		uint32_t box_hash;
+	} laser_cache;
+
+	// Sarah: resting toss/bounce entity that G_RunFrame is skipping; see G_EntityCanSleep.
+	// Not saved; anything that qualifies just goes back to sleep a frame after loading
+	bool sleeping;
+
 	// NOTE: if adding new elements, make sure to add them
 	// in g_save.cpp too!
 };
@@ -3314,7 +3653,7 @@ extern dm_game_rt DMGame;
 inline void monster_footstep(edict_t *self)
 {
 	if (self->groundentity)
-		self->s.event = EV_OTHER_FOOTSTEP;
+		G_SetEvent(self, EV_OTHER_FOOTSTEP);
 }
 
 // [Kex] helpers
@@ -7,7 +7,36 @@
 CHECK_GCLIENT_INTEGRITY;
 CHECK_EDICT_INTEGRITY;
 
-std::mt19937 mt_rand;
+// Sarah: see rng_stream_t
+std::array<rng_stream_t, RNG_TOTAL> rng_streams;
+const char *const rng_stream_names[RNG_TOTAL] = { "gameplay", "ai", "effects" };
+
+// splitmix64, to spread a single seed over each stream's state
+static uint64_t G_SplitMix64(uint64_t &x)
+{
+	uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+void rng_stream_t::seed(uint64_t seed)
+{
+	uint64_t a = G_SplitMix64(seed), b = G_SplitMix64(seed);
+
+	s = { (uint32_t) a, (uint32_t) (a >> 32), (uint32_t) b, (uint32_t) (b >> 32) };
+
+	// all-zero state never leaves zero
+	if (!(s[0] | s[1] | s[2] | s[3]))
+		s[0] = 1;
+}
+
+// every stream gets its own sequence from the one seed
+void G_SeedRandom(uint64_t seed)
+{
+	for (size_t i = 0; i < RNG_TOTAL; i++)
+		rng_streams[i].seed(seed + i * 0x632be59bd9b4e019ull);
+}
 
 game_locals_t  game;
 level_locals_t level;
@@ -128,6 +157,14 @@ cvar_t* g_start_items;
 cvar_t* g_map_list;
 cvar_t* g_map_list_shuffle;
 cvar_t *g_lag_compensation;
+cvar_t *g_script_memory_limit;
+cvar_t *g_validate_stats;
+cvar_t *g_rng_seed;
+cvar_t *g_log_rate;
+cvar_t *g_log_repeat_window;
+cvar_t *g_log_file;
+cvar_t *g_validate_events;
+cvar_t *g_ai_tick_budget;
 
 cvar_t *sv_airaccelerate;
 cvar_t *g_damage_scale;
@@ -221,7 +258,7 @@ void InitGame()
 	InitSave();
 
 	// seed RNG
-	mt_rand.seed((uint32_t) std::chrono::system_clock::now().time_since_epoch().count());
+	G_SeedRandom((uint64_t) std::chrono::system_clock::now().time_since_epoch().count());
 
 	gun_x = gi.cvar("gun_x", "0", CVAR_NOFLAGS);
 	gun_y = gi.cvar("gun_y", "0", CVAR_NOFLAGS);
@@ -351,6 +388,16 @@ void InitGame()
 	g_map_list = gi.cvar("g_map_list", "", CVAR_NOFLAGS);
 	g_map_list_shuffle = gi.cvar("g_map_list_shuffle", "0", CVAR_NOFLAGS);
 	g_lag_compensation = gi.cvar("g_lag_compensation", "1", CVAR_NOFLAGS);
+	g_script_memory_limit = gi.cvar("g_script_memory_limit", "0", CVAR_NOFLAGS);
+	g_validate_stats = gi.cvar("g_validate_stats", "0", CVAR_NOFLAGS);
+	g_rng_seed = gi.cvar("g_rng_seed", "0", CVAR_NOFLAGS);
+	g_log_rate = gi.cvar("g_log_rate", "200", CVAR_NOFLAGS);
+	g_log_repeat_window = gi.cvar("g_log_repeat_window", "1000", CVAR_NOFLAGS);
+	g_log_file = gi.cvar("g_log_file", "", CVAR_NOFLAGS);
+	g_validate_events = gi.cvar("g_validate_events", "0", CVAR_NOFLAGS);
+	// Sarah: monster frames per server tick before they're staggered; idle target checks get four
+	// times as many, past which an idle monster can take 200ms rather than 100ms to notice a player
+	g_ai_tick_budget = gi.cvar("g_ai_tick_budget", "8", CVAR_NOFLAGS);
 
 	// items
 	InitItems();
@@ -391,6 +438,12 @@ void ShutdownGame()
 {
 	gi.Com_Print("==== ShutdownGame ====\n");
 
+	// Sarah: send anything still held back
+	G_ShutdownLogging();
+
+	// Sarah: wait out any background script compile
+	script_shutdown();
+
 	gi.FreeTags(TAG_LEVEL);
 	gi.FreeTags(TAG_GAME);
 }
@@ -417,6 +470,12 @@ Q2GAME_API game_export_t *GetGameAPI(game_import_t *import)
 {
 	gi = *import;
 
+	// Sarah: route configstrings through the game so redundant writes can be dropped
+	G_InstallConfigStrings();
+
+	// Sarah: and prints, so spam can be buffered and folded up
+	G_InstallLogging();
+
 	FRAME_TIME_S = FRAME_TIME_MS = gtime_t::from_ms(gi.frame_time_ms);
 
 	globals.apiversion = GAME_API_VERSION;
@@ -473,6 +532,9 @@ void ClientEndServerFrames()
 {
 	edict_t *ent;
 
+	// Sarah: everything has moved, so start on fresh player visibility
+	G_PlayerVisibilityFrame();
+
 	// calc the player views now that all pushing
 	// and damage has been added
 	for (uint32_t i = 0; i < game.maxclients; i++)
@@ -580,7 +642,7 @@ void EndDMLevel()
 								return;
 							}
 
-							std::shuffle(values.begin(), values.end(), mt_rand);
+							std::shuffle(values.begin(), values.end(), rng_gameplay);
 
 							// if the current map is the map at the front, push it to the end
 							if (values[0] == level.mapname)
@@ -790,7 +852,11 @@ void ExitLevel()
 		!Q_strncasecmp(level.changemap + strlen(level.changemap) - 4, ".pcx", 4))
 		gi.AddCommandString(G_Fmt("endgame \"{}\"\n", level.changemap + start_offset).data());
 	else
+	{
+		// Sarah: usually already started by the changelevel, but not for every route here
+		script_prefetch(level.changemap);
 		gi.AddCommandString(G_Fmt("gamemap \"{}\"\n", level.changemap).data());
+	}
 
 	level.changemap = nullptr;
 }
@@ -891,6 +957,12 @@ inline void G_RunFrame_(bool main_loop)
 		}
 	}
 
+	// Sarah: bring back any items that are due
+	G_RunItemRespawns();
+
+	// Sarah: start counting this tick's monster work
+	M_BeginAIFrame();
+
 	//
 	// treat each object in turn
 	// even the world gets a chance to think
@@ -915,6 +987,13 @@ inline void G_RunFrame_(bool main_loop)
 
 		level.current_entity = ent;
 
+		// Sarah: resting toss/bounce entities have nothing to do
+		if (i > game.maxclients && G_SleepEntity(ent))
+		{
+			Entity_UpdateState( ent );
+			continue;
+		}
+
 		// Paril: RF_BEAM entities update their old_origin by hand.
 		if (!(ent->s.renderfx & RF_BEAM))
 			ent->s.old_origin = ent->s.origin;
@@ -953,6 +1032,12 @@ inline void G_RunFrame_(bool main_loop)
 		G_RunEntity(ent);
 	}
 
+	G_SleepFrame();
+
+	// Sarah: script event handlers
+	if (script_event_count[SCRIPT_EVENT_FRAME])
+		script_event_frame();
+
 	// see if it is time to end a deathmatch
 	CheckDMRules();
 
@@ -991,15 +1076,8 @@ inline void G_RunFrame_(bool main_loop)
 		level.entry->time += FRAME_TIME_S;
 
 	// [Paril-KEX] run monster pains now
-	for (uint32_t i = 0; i < globals.num_edicts + 1 + game.maxclients + BODY_QUEUE_SIZE; i++)
-	{
-		edict_t *e = &g_edicts[i];
-
-		if (!e->inuse || !(e->svflags & SVF_MONSTER))
-			continue;
-
-		M_ProcessPain(e);
-	}
+	// Sarah: only the ones that were hurt
+	M_ProcessPainQueue();
 
 	level.in_frame = false;
 }
@@ -1021,6 +1099,12 @@ void G_RunFrame(bool main_loop)
 	for (int32_t i = 0; i < g_frames_per_frame->integer; i++)
 		G_RunFrame_(main_loop);
 
+	// Sarah: send the configstrings that changed this frame
+	G_FlushConfigStrings();
+
+	// Sarah: and the lines printed during it
+	G_FlushLog();
+
 	// match details.. only bother if there's at least 1 player in-game
 	// and not already end of game
 	if (G_AnyPlayerSpawned() && !level.intermissiontime)
@@ -1045,8 +1129,8 @@ player processing happens outside RunFrame
 */
 void G_PrepFrame()
 {
-	for (uint32_t i = 0; i < globals.num_edicts; i++)
-		g_edicts[i].s.event = EV_NONE;
+	// Sarah: only the entities that had one set
+	G_ClearEvents();
 
 	for (auto player : active_players())
 		player->client->ps.stats[STAT_HIT_MARKER] = 0;
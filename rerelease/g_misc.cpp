@@ -37,9 +37,9 @@ Misc functions
 */
 void VelocityForDamage(int damage, vec3_t &v)
 {
-	v[0] = 100.0f * crandom();
-	v[1] = 100.0f * crandom();
-	v[2] = frandom(200.0f, 300.0f);
+	v[0] = 100.0f * rng_effects.crandom();
+	v[1] = 100.0f * rng_effects.crandom();
+	v[2] = rng_effects.frandom(200.0f, 300.0f);
 
 	if (damage < 50)
 		v = v * 0.7f;
@@ -94,7 +94,7 @@ edict_t *ThrowGib(edict_t *self, const char *gibname, int damage, gib_type_t typ
 	if (type & GIB_HEAD)
 	{
 		gib = self;
-		gib->s.event = EV_OTHER_TELEPORT;
+		G_SetEvent(gib, EV_OTHER_TELEPORT);
 		// remove setskin so that it doesn't set the skin wrongly later
 		self->monsterinfo.setskin = nullptr;
 	}
@@ -109,7 +109,7 @@ edict_t *ThrowGib(edict_t *self, const char *gibname, int damage, gib_type_t typ
 
 	for (i = 0; i < 3; i++)
 	{
-		gib->s.origin = origin + vec3_t { crandom(), crandom(), crandom() }.scaled(size);
+		gib->s.origin = origin + vec3_t { rng_effects.crandom(), rng_effects.crandom(), rng_effects.crandom() }.scaled(size);
 
 		// try 3 times to get a good, non-solid position
 		if (!(gi.pointcontents(gib->s.origin) & MASK_SOLID))
@@ -172,9 +172,9 @@ edict_t *ThrowGib(edict_t *self, const char *gibname, int damage, gib_type_t typ
 	if (type & GIB_DEBRIS)
 	{
 		vec3_t v;
-		v[0] = 100 * crandom();
-		v[1] = 100 * crandom();
-		v[2] = 100 + 100 * crandom();
+		v[0] = 100 * rng_effects.crandom();
+		v[1] = 100 * rng_effects.crandom();
+		v[2] = 100 + 100 * rng_effects.crandom();
 		gib->velocity = self->velocity + (v * damage);
 	}
 	else
@@ -190,20 +190,20 @@ edict_t *ThrowGib(edict_t *self, const char *gibname, int damage, gib_type_t typ
 		gib->flags |= FL_ALWAYS_TOUCH;
 	}
 
-	gib->avelocity[0] = frandom(600);
-	gib->avelocity[1] = frandom(600);
-	gib->avelocity[2] = frandom(600);
+	gib->avelocity[0] = rng_effects.frandom(600);
+	gib->avelocity[1] = rng_effects.frandom(600);
+	gib->avelocity[2] = rng_effects.frandom(600);
 
-	gib->s.angles[0] = frandom(359);
-	gib->s.angles[1] = frandom(359);
-	gib->s.angles[2] = frandom(359);
+	gib->s.angles[0] = rng_effects.frandom(359);
+	gib->s.angles[1] = rng_effects.frandom(359);
+	gib->s.angles[2] = rng_effects.frandom(359);
 
 	gib->think = G_FreeEdict;
 
 	if (g_instagib->integer)
-		gib->nextthink = level.time + random_time(1_sec, 5_sec);
+		gib->nextthink = level.time + rng_effects.random_time(1_sec, 5_sec);
 	else
-		gib->nextthink = level.time + random_time(10_sec, 20_sec);
+		gib->nextthink = level.time + rng_effects.random_time(10_sec, 20_sec);
 
 	gi.linkentity(gib);
 
@@ -222,7 +222,7 @@ void ThrowClientHead(edict_t *self, int damage)
 	vec3_t		vd;
 	const char *gibname;
 
-	if (brandom())
+	if (rng_effects.brandom())
 	{
 		gibname = "models/objects/gibs/head2/tris.md2";
 		self->s.skinnum = 1; // second skin is player
@@ -330,7 +330,7 @@ TOUCH(path_corner_touch) (edict_t *self, edict_t *other, const trace_t &tr, bool
 		v[2] -= other->mins[2];
 		other->s.origin = v;
 		next = G_PickTarget(next->target);
-		other->s.event = EV_OTHER_TELEPORT;
+		G_SetEvent(other, EV_OTHER_TELEPORT);
 	}
 
 	other->goalentity = other->movetarget = next;
@@ -2033,13 +2033,13 @@ TOUCH(teleporter_touch) (edict_t *self, edict_t *other, const trace_t &tr, bool
 	// draw the teleport splash at source and on the player
 	if (!self->spawnflags.has(SPAWNFLAG_TELEPORTER_NO_TELEPORT_EFFECT))
 	{
-		self->owner->s.event = EV_PLAYER_TELEPORT;
-		other->s.event = EV_PLAYER_TELEPORT;
+		G_SetEvent(self->owner, EV_PLAYER_TELEPORT);
+		G_SetEvent(other, EV_PLAYER_TELEPORT);
 	}
 	else
 	{
-		self->owner->s.event = EV_OTHER_TELEPORT;
-		other->s.event = EV_OTHER_TELEPORT;
+		G_SetEvent(self->owner, EV_OTHER_TELEPORT);
+		G_SetEvent(other, EV_OTHER_TELEPORT);
 	}
 
 	// set angles
@@ -2,6 +2,7 @@
 // Licensed under the GNU General Public License 2.0.
 #include "g_local.h"
 #include "bots/bot_includes.h"
+#include <chrono>
 
 //
 // monster weapons
@@ -489,6 +490,153 @@ void M_SetAnimation(edict_t *self, const save_mmove_t &move, bool instant)
 	self->monsterinfo.next_move = move;
 }
 
+// Sarah: monsters woken by the same thing all step their 10hz frames on the same tick,
+// so everything their frame thinkfuncs do (firing, tracing) lands at once. When a monster
+// schedules its next frame onto a tick that already has g_ai_tick_budget frames due and a
+// later tick within the same 10hz window has fewer, it's pushed back onto that one; after
+// that it keeps the new phase, so the load spreads over the subticks and stays spread.
+// Idle target checks get AI_IDLE_CHECK_BUDGET_SCALE times that budget per tick, so they're
+// only put off under heavy load; a monster that's over it skips the check until its next
+// think, but never twice in a row. That does mean an idle monster can take up to 200ms
+// instead of 100ms to notice a player while the server is that busy.
+constexpr size_t AI_SCHEDULE_TICKS = 16;
+constexpr size_t AI_MAX_SUBTICKS = 8;
+constexpr size_t AI_HISTOGRAM_BUCKETS = 8;
+constexpr uint32_t AI_IDLE_CHECK_BUDGET_SCALE = 4;
+
+static struct
+{
+	// frames due on each upcoming tick, indexed by tick number
+	std::array<uint32_t, AI_SCHEDULE_TICKS> scheduled;
+	int64_t tick;
+
+	uint32_t tick_frames, tick_idle_checks;
+	std::chrono::steady_clock::duration tick_cost;
+
+	// stats
+	uint64_t ticks, staggered, deferred_checks;
+	std::array<uint64_t, AI_MAX_SUBTICKS> phase_ticks, phase_frames, phase_us;
+	std::array<uint64_t, AI_HISTOGRAM_BUCKETS> cost_histogram; // ticks by microseconds of monster thinking: <50, <100, <200 ... >= 3200
+	uint64_t peak_us;
+	uint32_t peak_frames;
+} ai_schedule;
+
+static int64_t M_TickOf(gtime_t time)
+{
+	return time.milliseconds() / gi.frame_time_ms;
+}
+
+static size_t M_SubTicks()
+{
+	return clamp<size_t>(gi.tick_rate / 10, 1, AI_MAX_SUBTICKS);
+}
+
+// called at the start of every frame, before entities run
+void M_BeginAIFrame()
+{
+	int64_t tick = M_TickOf(level.time);
+
+	if (tick == ai_schedule.tick)
+		return;
+
+	// record what the tick that just finished cost
+	if (ai_schedule.tick)
+	{
+		uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(ai_schedule.tick_cost).count();
+		size_t phase = ai_schedule.tick % M_SubTicks();
+		size_t bucket = 0;
+
+		for (uint64_t limit = 50; bucket < AI_HISTOGRAM_BUCKETS - 1 && us >= limit; limit *= 2)
+			bucket++;
+
+		ai_schedule.ticks++;
+		ai_schedule.phase_ticks[phase]++;
+		ai_schedule.phase_frames[phase] += ai_schedule.tick_frames;
+		ai_schedule.phase_us[phase] += us;
+		ai_schedule.cost_histogram[bucket]++;
+		ai_schedule.peak_us = max(ai_schedule.peak_us, us);
+		ai_schedule.peak_frames = max(ai_schedule.peak_frames, ai_schedule.tick_frames);
+	}
+
+	// slots for ticks that have gone by are free for ones coming up
+	for (int64_t t = max(ai_schedule.tick, tick - (int64_t) AI_SCHEDULE_TICKS); t < tick; t++)
+		ai_schedule.scheduled[t % AI_SCHEDULE_TICKS] = 0;
+
+	ai_schedule.tick = tick;
+	ai_schedule.tick_frames = ai_schedule.tick_idle_checks = 0;
+	ai_schedule.tick_cost = {};
+}
+
+void M_ResetAISchedule()
+{
+	ai_schedule = {};
+}
+
+// when to run the next 10hz frame, if it would have been `time`
+static gtime_t M_ScheduleMoveFrame(gtime_t time)
+{
+	int64_t tick = M_TickOf(time);
+	size_t subticks = M_SubTicks();
+	int32_t budget = g_ai_tick_budget->integer;
+
+	if (budget > 0 && subticks > 1 && ai_schedule.scheduled[tick % AI_SCHEDULE_TICKS] >= (uint32_t) budget)
+	{
+		int64_t best = tick;
+
+		for (size_t i = 1; i < subticks; i++)
+			if (ai_schedule.scheduled[(tick + i) % AI_SCHEDULE_TICKS] + 1 < ai_schedule.scheduled[best % AI_SCHEDULE_TICKS])
+				best = tick + i;
+
+		if (best != tick)
+		{
+			ai_schedule.staggered++;
+			time += FRAME_TIME_MS * (best - tick);
+			tick = best;
+		}
+	}
+
+	ai_schedule.scheduled[tick % AI_SCHEDULE_TICKS]++;
+	return time;
+}
+
+// whether an idle monster should look for targets this tick
+bool M_AllowIdleCheck(edict_t *self)
+{
+	int32_t budget = g_ai_tick_budget->integer;
+
+	if (budget <= 0 || ai_schedule.tick_idle_checks < (uint32_t) budget * AI_IDLE_CHECK_BUDGET_SCALE || self->monsterinfo.idle_check_deferred)
+	{
+		ai_schedule.tick_idle_checks++;
+		self->monsterinfo.idle_check_deferred = false;
+		return true;
+	}
+
+	ai_schedule.deferred_checks++;
+	self->monsterinfo.idle_check_deferred = true;
+	return false;
+}
+
+void M_AIScheduleReport()
+{
+	const auto &s = ai_schedule;
+
+	gi.Com_PrintFmt("ticks={} staggered={} deferred_checks={} peak_frames={} peak_us={}\n",
+		s.ticks, s.staggered, s.deferred_checks, s.peak_frames, s.peak_us);
+
+	for (size_t i = 0; i < M_SubTicks(); i++)
+		gi.Com_PrintFmt("subtick {}: frames_per_tick={:.2} us_per_tick={:.1}\n", i,
+			s.phase_ticks[i] ? (double) s.phase_frames[i] / s.phase_ticks[i] : 0.0,
+			s.phase_ticks[i] ? (double) s.phase_us[i] / s.phase_ticks[i] : 0.0);
+
+	for (size_t i = 0, limit = 50; i < AI_HISTOGRAM_BUCKETS; i++, limit *= 2)
+	{
+		if (i < AI_HISTOGRAM_BUCKETS - 1)
+			gi.Com_PrintFmt("< {}us: {}\n", limit, s.cost_histogram[i]);
+		else
+			gi.Com_PrintFmt(">= {}us: {}\n", limit / 2, s.cost_histogram[i]);
+	}
+}
+
 void M_MoveFrame(edict_t *self)
 {
 	const mmove_t *move = self->monsterinfo.active_move.pointer();
@@ -577,7 +725,9 @@ void M_MoveFrame(edict_t *self)
 		if (self->monsterinfo.aiflags & AI_HIGH_TICK_RATE)
 			self->monsterinfo.next_move_time = level.time;
 		else
-			self->monsterinfo.next_move_time = level.time + 10_hz;
+			self->monsterinfo.next_move_time = M_ScheduleMoveFrame(level.time + 10_hz);
+
+		ai_schedule.tick_frames++;
 
 		if ((self->monsterinfo.nextframe) && !((self->monsterinfo.nextframe >= move->firstframe) &&
 			(self->monsterinfo.nextframe <= move->lastframe)))
@@ -646,6 +796,81 @@ void G_MonsterKilled(edict_t *self)
 	}
 }
 
+// Sarah: monsters that took damage are queued by T_Damage, so the end of the frame only
+// visits them instead of every edict. They're run in entity order like the old sweep was,
+// including picking up monsters further along that get hurt while the queue is running;
+// ones that get hurt behind the cursor wait for the next frame, as they always did.
+struct pain_queue_entry_t
+{
+	edict_t *ent;
+	int32_t	 spawn_count;
+};
+
+static std::vector<pain_queue_entry_t> pain_queue;
+
+void M_QueuePain(edict_t *e)
+{
+	pain_queue.push_back({ e, e->spawn_count });
+}
+
+void M_ClearPainQueue()
+{
+	pain_queue.clear();
+}
+
+void M_ProcessPainQueue()
+{
+	static std::vector<pain_queue_entry_t> processing, carried;
+
+	auto by_number = [](const pain_queue_entry_t &a, const pain_queue_entry_t &b) { return a.ent < b.ent; };
+
+	processing.clear();
+	carried.clear();
+
+	const edict_t *cursor = nullptr;
+	size_t next = 0;
+
+	while (true)
+	{
+		// anything hurt since the last pass that the sweep hasn't reached yet joins it
+		auto ahead = std::stable_partition(pain_queue.begin(), pain_queue.end(), [cursor](const pain_queue_entry_t &entry) { return entry.ent <= cursor; });
+
+		if (ahead != pain_queue.end())
+		{
+			processing.insert(processing.end(), ahead, pain_queue.end());
+			pain_queue.erase(ahead, pain_queue.end());
+			std::sort(processing.begin() + next, processing.end(), by_number);
+		}
+
+		if (next == processing.size())
+			break;
+
+		pain_queue_entry_t entry = processing[next++];
+
+		// queued more than once
+		if (entry.ent == cursor)
+			continue;
+
+		cursor = entry.ent;
+
+		if (!entry.ent->inuse || entry.ent->spawn_count != entry.spawn_count)
+			continue;
+
+		// not a monster right now; the old sweep would have found it again later
+		if (!(entry.ent->svflags & SVF_MONSTER))
+		{
+			if (entry.ent->monsterinfo.damage_blood)
+				carried.push_back(entry);
+
+			continue;
+		}
+
+		M_ProcessPain(entry.ent);
+	}
+
+	pain_queue.insert(pain_queue.end(), carried.begin(), carried.end());
+}
+
 void M_ProcessPain(edict_t *e)
 {
 	if (!e->monsterinfo.damage_blood)
@@ -907,6 +1132,13 @@ static bool CheckPathVisibility(const vec3_t &start, const vec3_t &end)
 
 THINK(monster_think) (edict_t *self) -> void
 {
+	// Sarah: time spent thinking goes into the AI schedule stats
+	struct ai_cost_t
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		~ai_cost_t() { ai_schedule.tick_cost += std::chrono::steady_clock::now() - start; }
+	} ai_cost;
+
 	// [Paril-KEX] monster sniff testing; if we can make an unobstructed path to the player, murder ourselves.
 	if (g_debug_monster_kills->integer)
 	{
@@ -853,7 +853,7 @@ void SV_Physics_Step(edict_t *ent)
 		if (ent->groundentity)
 			if (!wasonground)
 				if (hitsound)
-					ent->s.event = EV_FOOTSTEP;
+					G_SetEvent(ent, EV_FOOTSTEP);
 	}
 
 	if (!ent->inuse) // PGM g_touchtrigger free problem
@@ -944,6 +944,84 @@ G_RunEntity
 
 ================
 */
+// Sarah: a toss or bounce entity lying still on the ground does nothing in G_RunEntity
+// except find out it has nothing to do, so G_RunFrame lets it sleep instead. This is
+// exactly the case where SV_Physics_Toss returns straight after SV_RunThink, and it's
+// checked again every frame before skipping it, so anything that disturbs it (its
+// ground moving, velocity from T_Damage or anything else, being teleported or pushed,
+// a think coming due) wakes it on the frame it happens.
+static struct
+{
+	uint32_t sleeping, awake, frames;
+	uint64_t total_sleeping, total_awake, slept, woken;
+} sleep_stats;
+
+bool G_EntityCanSleep(const edict_t *ent)
+{
+	if (ent->movetype != MOVETYPE_TOSS && ent->movetype != MOVETYPE_BOUNCE)
+		return false;
+	else if ((ent->svflags & SVF_MONSTER) || ent->client || ent->gravity <= 0.0f)
+		return false;
+	else if (ent->prethink || ent->postthink || ent->bmodel_anim.enabled || (ent->s.renderfx & RF_BEAM))
+		return false;
+	// a think is due
+	else if (ent->nextthink > 0_ms && ent->nextthink <= level.time)
+		return false;
+	else if (ent->velocity || ent->avelocity)
+		return false;
+	// moved by something else since last frame
+	else if (ent->s.origin != ent->s.old_origin)
+		return false;
+	else if (!ent->groundentity || !ent->groundentity->inuse || ent->groundentity->linkcount != ent->groundentity_linkcount)
+		return false;
+
+	return true;
+}
+
+// called for every entity G_RunFrame visits; returns true if it should be skipped
+bool G_SleepEntity(edict_t *ent)
+{
+	bool can_sleep = G_EntityCanSleep(ent);
+
+	if (can_sleep != ent->sleeping)
+	{
+		if (can_sleep)
+			sleep_stats.slept++;
+		else
+			sleep_stats.woken++;
+
+		ent->sleeping = can_sleep;
+	}
+
+	if (ent->movetype == MOVETYPE_TOSS || ent->movetype == MOVETYPE_BOUNCE)
+	{
+		if (can_sleep)
+			sleep_stats.sleeping++;
+		else
+			sleep_stats.awake++;
+	}
+
+	return can_sleep;
+}
+
+// called at the end of every frame
+void G_SleepFrame()
+{
+	sleep_stats.total_sleeping += sleep_stats.sleeping;
+	sleep_stats.total_awake += sleep_stats.awake;
+	sleep_stats.frames++;
+	sleep_stats.sleeping = sleep_stats.awake = 0;
+}
+
+void G_SleepReport()
+{
+	const auto &s = sleep_stats;
+
+	gi.Com_PrintFmt("frames={} sleeping_per_frame={:.1} awake_per_frame={:.1} slept={} woken={}\n",
+		s.frames, s.frames ? (double) s.total_sleeping / s.frames : 0.0, s.frames ? (double) s.total_awake / s.frames : 0.0,
+		s.slept, s.woken);
+}
+
 void G_RunEntity(edict_t *ent)
 {
 	// PGM
@@ -1082,6 +1082,7 @@ SAVE_STRUCT_START
 	FIELD_AUTO(random),
 
 	FIELD_AUTO(teleport_time),
+	FIELD_AUTO(item_respawn_time),
 		
 	FIELD_AUTO(watertype),
 	FIELD_AUTO(waterlevel),
@@ -2420,19 +2421,7 @@ char *WriteGameJson(bool autosave, size_t *out_size)
 	json["clients"] = std::move(clients);
 
 	// Sarah: write persistent variables
-	std::unordered_map<std::string, std::string> persistent_variables;
-
-	script_get_variables(persistent_variables, true);
-
-	Json::Value persistent_variables_json(Json::objectValue);
-
-	for (auto it = persistent_variables.begin(); it != persistent_variables.end(); ++it)
-	{
-		auto value = Json::Value(it->second);
-		persistent_variables_json[it->first] = value;
-	}
-
-	json["script_persistent_variables"] = std::move(persistent_variables_json);
+	script_write_variables(json["script_persistent_variables"], true);
 
 	return saveJson(json, out_size);
 }
@@ -2484,20 +2473,7 @@ void ReadGameJson(const char *jsonString)
 	}
 
 	// Sarah: read persistent variables
-	std::unordered_map<std::string, std::string> persistent_variables;
-
-	const Json::Value& persistent_variables_json = json["script_persistent_variables"];
-
-	for (auto it = persistent_variables_json.begin(); it != persistent_variables_json.end(); ++it)
-	{
-		const char* dummy;
-		const char* key = it.memberName(&dummy);
-		const Json::Value& value = *it;
-
-		persistent_variables.insert_or_assign(key, value.asString());
-	}
-
-	script_set_variables(persistent_variables, true);
+	script_read_variables(json["script_persistent_variables"], true);
 
 	G_PrecacheInventoryItems();
 }
@@ -2544,19 +2520,19 @@ char *WriteLevelJson(bool transition, size_t *out_size)
 	json["entities"] = std::move(entities);
 
 	// Sarah: write script variables
-	std::unordered_map<std::string, std::string> script_variables;
-
-	script_get_variables(script_variables);
-
-	Json::Value script_variables_json(Json::objectValue);
+	script_write_variables(json["script_variables"]);
 
-	for (auto it = script_variables.begin(); it != script_variables.end(); ++it)
+	// Sarah: random number state, so a loaded game carries on the same way
+	if (!transition)
 	{
-		auto value = Json::Value(it->second);
-		script_variables_json[it->first] = value;
-	}
+		for (size_t i = 0; i < RNG_TOTAL; i++)
+		{
+			Json::Value &state = json["rng"][rng_stream_names[i]];
 
-	json["script_variables"] = std::move(script_variables_json);
+			for (uint32_t v : rng_streams[i].s)
+				state.append(v);
+		}
+	}
 
 	return saveJson(json, out_size);
 }
@@ -2569,6 +2545,9 @@ void ReadLevelJson(const char *jsonString)
 	// Sarah: Reset bookmarks for spawning
 	G_Spawn_Reset();
 
+	// Sarah: the script's pooled strings are about to be freed
+	script_release_level_strings();
+
 	// free any dynamic memory allocated by loading the level
 	// base state
 	gi.FreeTags(TAG_LEVEL);
@@ -2637,20 +2616,26 @@ void ReadLevelJson(const char *jsonString)
 	}
 
 	// Sarah: read script variables
-	std::unordered_map<std::string, std::string> script_variables;
-
-	const Json::Value& script_variables_json = json["script_variables"];
+	script_read_variables(json["script_variables"]);
 
-	for (auto it = script_variables_json.begin(); it != script_variables_json.end(); ++it)
+	// Sarah: random number state, if there is one
+	if (json.isMember("rng"))
 	{
-		const char* dummy;
-		const char* key = it.memberName(&dummy);
-		const Json::Value& value = *it;
+		for (size_t i = 0; i < RNG_TOTAL; i++)
+		{
+			const Json::Value &state = json["rng"][rng_stream_names[i]];
 
-		script_variables.insert_or_assign(key, value.asString());
-	}
+			if (!state.isArray() || state.size() != 4)
+				continue;
+
+			for (Json::ArrayIndex j = 0; j < 4; j++)
+				rng_streams[i].s[j] = state[j].asUInt();
 
-	script_set_variables(script_variables);
+			// all-zero state never leaves zero
+			if (!(rng_streams[i].s[0] | rng_streams[i].s[1] | rng_streams[i].s[2] | rng_streams[i].s[3]))
+				rng_streams[i].s[0] = 1;
+		}
+	}
 
 	G_PrecacheInventoryItems();
 
@@ -2658,6 +2643,13 @@ void ReadLevelJson(const char *jsonString)
 	cached_soundindex::reset_all();
 	cached_modelindex::reset_all();
 	cached_imageindex::reset_all();
+	G_InvalidateStatsCache();
+
+	// Sarah: put pending item respawns back on the wheel
+	G_ResetItemRespawns();
+	M_ClearPainQueue();
+	G_ResetEvents();
+	M_ResetAISchedule();
 
 	G_LoadShadowLights();
 }
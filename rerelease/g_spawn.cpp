@@ -585,6 +585,10 @@ void ED_CallSpawn(edict_t *ent)
 			spawns[found->index].spawn(ent);
 		}
 
+		// Sarah: script event handlers
+		if (script_event_count[SCRIPT_EVENT_SPAWN] && ent->inuse)
+			script_event_entity(SCRIPT_EVENT_SPAWN, ent, nullptr, 0);
+
 		return;
 	}
 
@@ -634,6 +638,11 @@ struct field_t
 {
 	const char *name;
 	void (*load_func) (edict_t *e, const char *s) = nullptr;
+	// Sarah: for fields copied directly to the entity, converts the value into a buffer
+	// ahead of time so it can be copied into the member at the given offset later
+	void (*convert_func) (void *out, const char *s) = nullptr;
+	size_t offset = 0;
+	size_t size = 0;
 };
 
 // utility template for getting the type of a field
@@ -699,6 +708,19 @@ struct type_loaders_t
 		e->M = type_loaders_t::load<decltype(e->M)>(s); \
 	}
 
+// Sarah: converter for prepared fields; FIELD_CONTAINER is the structure the field list belongs to
+// Strings have no converter, so they go through the loader and every entity gets its own copy
+// like it would from the entity string, instead of them all sharing one
+#define AUTO_CONVERT_FUNC(M) \
+	(std::is_same_v<decltype(std::declval<FIELD_CONTAINER &>().M), const char *> ? nullptr : \
+	(void (*) (void *, const char *)) [](void *out, const char *s) { \
+		using T = decltype(std::declval<FIELD_CONTAINER &>().M); \
+		static_assert(sizeof(T) <= sizeof(prepared_field_t::data), "field too large to prepare"); \
+		*(T *) out = type_loaders_t::load<T>(s); \
+	})
+
+#define FIELD_CONTAINER edict_t
+
 static int32_t ED_LoadColor(const char *value)
 {
 	// space means rgba as values
@@ -740,10 +762,10 @@ static int32_t ED_LoadColor(const char *value)
 // clang-format off
 // fields that get copied directly to edict_t
 #define FIELD_AUTO(x) \
-	{ #x, AUTO_LOADER_FUNC(x) }
+	{ #x, AUTO_LOADER_FUNC(x), AUTO_CONVERT_FUNC(x), offsetof(FIELD_CONTAINER, x), sizeof(std::declval<FIELD_CONTAINER &>().x) }
 
 #define FIELD_AUTO_NAMED(n, x) \
-	{ n, AUTO_LOADER_FUNC(x) }
+	{ n, AUTO_LOADER_FUNC(x), AUTO_CONVERT_FUNC(x), offsetof(FIELD_CONTAINER, x), sizeof(std::declval<FIELD_CONTAINER &>().x) }
 
 // Sarah: turned into a normal array
 static const struct field_t entity_fields[] = {
@@ -873,16 +895,22 @@ static const struct field_t entity_fields[] = {
 };
 
 #undef AUTO_LOADER_FUNC
+#undef FIELD_CONTAINER
 
 #define AUTO_LOADER_FUNC(M) \
 	[](spawn_temp_t *e, const char *s) { \
 		e->M = type_loaders_t::load<decltype(e->M)>(s); \
 	}
 
+#define FIELD_CONTAINER spawn_temp_t
+
 struct temp_field_t
 {
 	const char *name;
 	void (*load_func) (spawn_temp_t *e, const char *s) = nullptr;
+	void (*convert_func) (void *out, const char *s) = nullptr;
+	size_t offset = 0;
+	size_t size = 0;
 };
 
 // temp spawn vars -- only valid when the spawn function is called
@@ -941,6 +969,8 @@ static const struct temp_field_t temp_fields[] = {
 };
 // clang-format on
 
+#undef FIELD_CONTAINER
+
 // Sarah: Create list for entity key parse functions
 struct parselist_t
 {
@@ -1011,14 +1041,20 @@ static int ED_ParselistSearch(const void* pa, const void* pb)
 	return Q_strcasecmp(str1, str2);
 }
 
+// Sarah: find the parse function for a key
+static struct parselist_t* ED_FindField(const char* key)
+{
+	return (struct parselist_t*)bsearch(key, parselist, parselist_count, sizeof(struct parselist_t), ED_ParselistSearch);
+}
+
 void ED_ParseField(const char *key, const char *value, edict_t *ent)
 {
 	// Sarah: Use bsearch for finding entity key parse function
-	struct parselist_t* found = (struct parselist_t*)bsearch(key, parselist, parselist_count, sizeof(struct parselist_t), ED_ParselistSearch);
+	struct parselist_t* found = ED_FindField(key);
 
 	if (found != nullptr)
 	{
-		st.keys_specified.emplace(temp_fields[found->index].name);
+		st.keys_specified.emplace(found->name);
 
 		if (found->isTemp)
 		{
@@ -1041,6 +1077,67 @@ void ED_ParseField(const char *key, const char *value, edict_t *ent)
 	gi.Com_PrintFmt("{} is not a valid field\n", key);
 }
 
+// Sarah: look up a key and convert its value once, so it can be applied to many entities later
+// Converted strings are allocated as TAG_LEVEL, so prepared fields are only good for the current level
+bool ED_PrepareField(const char* key, const char* value, prepared_field_t& prepared)
+{
+	struct parselist_t* found = ED_FindField(key);
+
+	if (found == nullptr)
+	{
+		gi.Com_PrintFmt("{} is not a valid field\n", key);
+		return false;
+	}
+
+	prepared.field = found;
+	prepared.value = value;
+
+	auto convert_func = found->isTemp ? temp_fields[found->index].convert_func : entity_fields[found->index].convert_func;
+
+	if (convert_func)
+	{
+		convert_func(prepared.data, value);
+	}
+
+	return true;
+}
+
+// Sarah: same result as ED_ParseField but without the lookup, and without any parsing for
+// fields that are copied directly to the entity
+void ED_ApplyPreparedField(const prepared_field_t& prepared, edict_t* ent)
+{
+	const struct parselist_t* found = prepared.field;
+
+	st.keys_specified.emplace(found->name);
+
+	if (found->isTemp)
+	{
+		const struct temp_field_t& field = temp_fields[found->index];
+
+		if (field.convert_func)
+		{
+			memcpy((uint8_t*)&st + field.offset, prepared.data, field.size);
+		}
+		else if (field.load_func)
+		{
+			field.load_func(&st, prepared.value);
+		}
+	}
+	else
+	{
+		const struct field_t& field = entity_fields[found->index];
+
+		if (field.convert_func)
+		{
+			memcpy((uint8_t*)ent + field.offset, prepared.data, field.size);
+		}
+		else if (field.load_func)
+		{
+			field.load_func(ent, prepared.value);
+		}
+	}
+}
+
 /*
 ====================
 ED_ParseEdict
@@ -1295,6 +1392,10 @@ void SpawnEntities(const char *mapname, const char *entities, const char *spawnp
 	cached_soundindex::clear_all();
 	cached_modelindex::clear_all();
 	cached_imageindex::clear_all();
+	G_InvalidateStatsCache();
+	M_ClearPainQueue();
+	G_ResetEvents();
+	M_ResetAISchedule();
 
 	edict_t *ent;
 	int		 inhibit;
@@ -1306,6 +1407,9 @@ void SpawnEntities(const char *mapname, const char *entities, const char *spawnp
 
 	SaveClientData();
 
+	// Sarah: the last map's script has to go before its strings do
+	script_unload();
+
 	gi.FreeTags(TAG_LEVEL);
 
 	memset(&level, 0, sizeof(level));
@@ -1323,6 +1427,17 @@ void SpawnEntities(const char *mapname, const char *entities, const char *spawnp
 
 	level.is_n64 = strncmp(level.mapname, "q64/", 4) == 0;
 
+	// Sarah: a fixed seed makes every run of a level play out the same, for benchmarks
+	if (g_rng_seed->integer)
+	{
+		uint64_t seed = (uint32_t) g_rng_seed->integer;
+
+		for (const char *c = level.mapname; *c; c++)
+			seed = (seed ^ (uint8_t) *c) * 0x100000001b3ull;
+
+		G_SeedRandom(seed);
+	}
+
 	level.coop_scale_players = 0;
 	level.coop_health_scaling = clamp(g_coop_health_scaling->value, 0.f, 1.f);
 
@@ -1423,6 +1538,9 @@ void SpawnEntities(const char *mapname, const char *entities, const char *spawnp
 
 	G_FindTeams();
 
+	// Sarah: item teams and the respawn wheel start fresh
+	G_ResetItemRespawns();
+
 	// ZOID
 	CTFSpawn();
 	// ZOID
@@ -297,6 +297,39 @@ void ServerCommand()
 		SVCmd_WriteIP_f();
 	else if (Q_strcasecmp(cmd, "nextmap") == 0)
 		SVCmd_NextMap_f();
+	// Sarah: script memory usage
+	else if (Q_strcasecmp(cmd, "script_mem") == 0)
+		script_memory_report();
+	// Sarah: how much script compilation happened in the background during changelevels
+	else if (Q_strcasecmp(cmd, "script_prefetch") == 0)
+		script_prefetch_report();
+	// Sarah: target_laser trace counts
+	else if (Q_strcasecmp(cmd, "laser_stats") == 0)
+		target_laser_report();
+	// Sarah: shared player visibility counts
+	else if (Q_strcasecmp(cmd, "vis_stats") == 0)
+		G_PlayerVisibilityReport();
+	// Sarah: player stat recompute counts
+	else if (Q_strcasecmp(cmd, "stats_cache") == 0)
+		G_StatsCacheReport();
+	// Sarah: layout bytes saved
+	else if (Q_strcasecmp(cmd, "layout_stats") == 0)
+		G_LayoutReport();
+	// Sarah: configstring writes dropped
+	else if (Q_strcasecmp(cmd, "cs_stats") == 0)
+		G_ConfigStringReport();
+	// Sarah: console lines folded up or dropped
+	else if (Q_strcasecmp(cmd, "log_stats") == 0)
+		G_LogReport();
+	// Sarah: item respawn wheel
+	else if (Q_strcasecmp(cmd, "respawn_stats") == 0)
+		G_ItemRespawnReport();
+	// Sarah: monster think spread over subticks
+	else if (Q_strcasecmp(cmd, "ai_stats") == 0)
+		M_AIScheduleReport();
+	// Sarah: toss/bounce entities skipped while at rest
+	else if (Q_strcasecmp(cmd, "sleep_stats") == 0)
+		G_SleepReport();
 	else
 		gi.LocClient_Print(nullptr, PRINT_HIGH, "Unknown server command \"{}\"\n", cmd);
 }
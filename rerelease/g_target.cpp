@@ -460,6 +460,9 @@ USE(use_target_changelevel) (edict_t *self, edict_t *other, edict_t *activator)
 		}
 	}
 
+	// Sarah: get the next map's script compiling while the intermission plays out
+	script_prefetch(self->map);
+
 	BeginIntermission(self);
 }
 
@@ -690,6 +693,8 @@ struct laser_pierce_t : pierce_args_t
 	edict_t *self;
 	int32_t count;
 	bool damaged_thing = false;
+	// Sarah: went through something that could be damaged, whether or not it was this time
+	bool damageable_thing = false;
 
 	inline laser_pierce_t(edict_t *self, int32_t count) :
 		pierce_args_t(),
@@ -702,6 +707,9 @@ struct laser_pierce_t : pierce_args_t
 	// you can adjust the mask for the re-trace (for water, etc).
 	virtual bool hit(contents_t &mask, vec3_t &end) override
 	{
+		if ((tr.ent->takedamage) && !(tr.ent->flags & FL_IMMUNE_LASER))
+			damageable_thing = true;
+
 		// hurt it if we can
 		if (self->dmg > 0 && (tr.ent->takedamage) && !(tr.ent->flags & FL_IMMUNE_LASER) && self->damage_debounce_time <= level.time)
 		{
@@ -736,6 +744,74 @@ struct laser_pierce_t : pierce_args_t
 	}
 };
 
+// Sarah: lasers remember their last beam and skip the trace when nothing could have changed,
+// which is when the laser hasn't moved or changed direction (which covers its enemy moving),
+// no sparks are due, it isn't due to damage anything, and the solid entities in the beam's
+// bounding box are the same ones with the same link counts. Entities get a new link count
+// whenever they're linked, so anything moving, appearing, or disappearing in the box is caught.
+static uint64_t laser_traces, laser_traces_skipped;
+
+struct laser_box_hash_t
+{
+	edict_t *self;
+	uint32_t hash;
+};
+
+static BoxEdictsResult_t target_laser_BoxFilter(edict_t *ent, void *data)
+{
+	laser_box_hash_t *box = (laser_box_hash_t *) data;
+
+	if (ent == box->self)
+		return BoxEdictsResult_t::Skip;
+
+	// order-independent, since the order entities come back in isn't guaranteed
+	uint32_t v = (uint32_t) ent->s.number * 2654435761u;
+	v ^= (uint32_t) ent->linkcount * 2246822519u;
+	v ^= (uint32_t) ent->takedamage | ((ent->flags & FL_IMMUNE_LASER) ? 2u : 0u);
+	box->hash += v ^ (v >> 15);
+
+	return BoxEdictsResult_t::Skip;
+}
+
+static uint32_t target_laser_box_hash(edict_t *self, const vec3_t &start, const vec3_t &end)
+{
+	laser_box_hash_t box { self, 0 };
+	vec3_t mins, maxs;
+
+	for (int i = 0; i < 3; i++)
+	{
+		mins[i] = min(start[i], end[i]) - 1;
+		maxs[i] = max(start[i], end[i]) + 1;
+	}
+
+	gi.BoxEdicts(mins, maxs, nullptr, 0, AREA_SOLID, target_laser_BoxFilter, &box);
+
+	return box.hash;
+}
+
+static bool target_laser_cache_valid(edict_t *self)
+{
+	const auto &cache = self->laser_cache;
+
+	if (!cache.valid)
+		return false;
+	// sparks are due
+	if (self->spawnflags.has(SPAWNFLAG_LASER_ZAP))
+		return false;
+	if (cache.start != self->s.origin || cache.dir != self->movedir)
+		return false;
+	// something in the beam is due to be hurt again
+	if (cache.damageable && self->dmg > 0 && self->damage_debounce_time <= level.time)
+		return false;
+
+	return cache.box_hash == target_laser_box_hash(self, self->s.origin, self->s.old_origin);
+}
+
+void target_laser_report()
+{
+	gi.Com_PrintFmt("target_laser: {} traces, {} skipped\n", laser_traces, laser_traces_skipped);
+}
+
 THINK(target_laser_think) (edict_t *self) -> void
 {
 	int32_t count;
@@ -755,8 +831,20 @@ THINK(target_laser_think) (edict_t *self) -> void
 			self->spawnflags |= SPAWNFLAG_LASER_ZAP;
 	}
 
+	self->nextthink = level.time + FRAME_TIME_S;
+
+	// Sarah: nothing could have changed since the last trace
+	if (target_laser_cache_valid(self))
+	{
+		laser_traces_skipped++;
+		return;
+	}
+
+	laser_traces++;
+
 	vec3_t start = self->s.origin;
 	vec3_t end = start + (self->movedir * 2048);
+	vec3_t last_end = self->s.old_origin;
 	
 	laser_pierce_t args {
 		self,
@@ -767,13 +855,23 @@ THINK(target_laser_think) (edict_t *self) -> void
 
 	pierce_trace(start, end, self, args, mask);
 
+	// put back anything the beam went through now, so it's linked as it will be next frame
+	args.restore();
+
 	self->s.old_origin = args.tr.endpos;
 
 	if (args.damaged_thing)
 		self->damage_debounce_time = level.time + 10_hz;
 
-	self->nextthink = level.time + FRAME_TIME_S;
-	gi.linkentity(self);
+	// Sarah: only relink if the beam changed
+	if (!self->laser_cache.valid || self->laser_cache.start != start || last_end != self->s.old_origin)
+		gi.linkentity(self);
+
+	self->laser_cache.valid = true;
+	self->laser_cache.damageable = args.damageable_thing;
+	self->laser_cache.start = start;
+	self->laser_cache.dir = self->movedir;
+	self->laser_cache.box_hash = target_laser_box_hash(self, start, self->s.old_origin);
 }
 
 void target_laser_on(edict_t *self)
@@ -792,6 +890,7 @@ void target_laser_off(edict_t *self)
 	self->svflags |= SVF_NOCLIENT;
 	self->flags &= ~FL_TRAP;
 	self->nextthink = 0_ms;
+	self->laser_cache.valid = false;
 }
 
 USE(target_laser_use) (edict_t *self, edict_t *other, edict_t *activator) -> void
@@ -1175,7 +1274,7 @@ THINK(update_target_camera) (edict_t *self) -> void
 			{
 				if (self->enemy)
 				{
-					self->enemy->s.event = EV_PLAYER_TELEPORT;
+					G_SetEvent(self->enemy, EV_PLAYER_TELEPORT);
 					self->enemy->hackflags = HACKFLAG_TELEPORT_OUT;
 					self->enemy->pain_debounce_time = self->enemy->timestamp = gtime_t::from_sec(self->movetarget->wait);
 				}
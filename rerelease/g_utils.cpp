@@ -3,6 +3,7 @@
 // g_utils.c -- misc utility functions for game module
 
 #include "g_local.h"
+#include <chrono>
 
 /*
 =============
@@ -43,24 +44,43 @@ findradius (origin, radius)
 */
 edict_t *findradius(edict_t *from, const vec3_t &org, float rad)
 {
-	vec3_t eorg;
-	int	   j;
+	// Sarah: candidates are gathered a few at a time and tested together,
+	// comparing squared distances
+	vec3_batch_t<16> centers;
+	edict_t			*candidates[decltype(centers)::capacity];
+	alignas(16) float dist[decltype(centers)::capacity];
+
+	if (rad < 0)
+		return nullptr;
+
+	const float rad_squared = rad * rad;
 
 	if (!from)
 		from = g_edicts;
 	else
 		from++;
-	for (; from < &g_edicts[globals.num_edicts]; from++)
+
+	edict_t *end = &g_edicts[globals.num_edicts];
+
+	while (from < end)
 	{
-		if (!from->inuse)
-			continue;
-		if (from->solid == SOLID_NOT)
-			continue;
-		for (j = 0; j < 3; j++)
-			eorg[j] = org[j] - (from->s.origin[j] + (from->mins[j] + from->maxs[j]) * 0.5f);
-		if (eorg.length() > rad)
-			continue;
-		return from;
+		centers.clear();
+
+		for (; from < end && !centers.full(); from++)
+		{
+			if (!from->inuse)
+				continue;
+			if (from->solid == SOLID_NOT)
+				continue;
+			candidates[centers.count] = from;
+			centers.push(from->s.origin + (from->mins + from->maxs) * 0.5f);
+		}
+
+		vec3_batch_distance_squared(centers, org, dist);
+
+		for (size_t i = 0; i < centers.count; i++)
+			if (dist[i] <= rad_squared)
+				return candidates[i];
 	}
 
 	return nullptr;
@@ -469,6 +489,10 @@ THINK(G_FreeEdict) (edict_t *ed) -> void
 
 	gi.Bot_UnRegisterEdict( ed );
 
+	// Sarah: a dropped flag going away changes what SetCTFStats shows
+	if (ed->item && (ed->item->id == IT_FLAG1 || ed->item->id == IT_FLAG2))
+		CTFFlagStateChanged();
+
 	int32_t id = ed->spawn_count + 1;
 	memset(ed, 0, sizeof(*ed));
 	ed->s.number = ed - g_edicts;
@@ -657,3 +681,582 @@ bool KillBox(edict_t *ent, bool from_spawning, mod_id_t mod, bool bsp_clipping)
 
 	return true; // all clear
 }
+
+// Sarah: player-to-player visibility, shared by everything that wants to know whether one
+// player can see another. Each pair is worked out at most once until something moves, which
+// bumps the generation; rows are cleared lazily the first time they're touched after that.
+enum player_vis_t : uint8_t
+{
+	PLAYER_VIS_PVS_KNOWN = 1,
+	PLAYER_VIS_PVS = 2,
+	PLAYER_VIS_LOS_KNOWN = 4,
+	PLAYER_VIS_LOS = 8
+};
+
+static uint8_t player_vis[MAX_CLIENTS][MAX_CLIENTS];
+static uint32_t player_vis_row_generation[MAX_CLIENTS];
+static uint32_t player_vis_generation = 1;
+
+static struct
+{
+	uint64_t frames;
+	uint64_t pvs_checks, pvs_reused;
+	uint64_t los_checks, los_reused;
+	uint64_t traces;
+	uint32_t frame_traces, peak_frame_traces;
+} player_vis_stats;
+
+static uint8_t &G_PlayerVisEntry(edict_t *a, edict_t *b)
+{
+	uint32_t row = a->s.number - 1;
+
+	if (player_vis_row_generation[row] != player_vis_generation)
+	{
+		memset(player_vis[row], 0, sizeof(player_vis[row]));
+		player_vis_row_generation[row] = player_vis_generation;
+	}
+
+	return player_vis[row][b->s.number - 1];
+}
+
+// PVS is symmetrical, so one check fills in both directions
+bool G_PlayerInPVS(edict_t *a, edict_t *b)
+{
+	uint8_t &entry = G_PlayerVisEntry(a, b);
+
+	if (entry & PLAYER_VIS_PVS_KNOWN)
+	{
+		player_vis_stats.pvs_reused++;
+		return entry & PLAYER_VIS_PVS;
+	}
+
+	player_vis_stats.pvs_checks++;
+
+	uint8_t result = PLAYER_VIS_PVS_KNOWN | (gi.inPVS(a->s.origin, b->s.origin, false) ? PLAYER_VIS_PVS : 0);
+
+	entry |= result;
+	G_PlayerVisEntry(b, a) |= result;
+
+	return result & PLAYER_VIS_PVS;
+}
+
+// same as CTF's loc_CanSee, which traces from the eyes of "from" to the corners of "targ"'s box,
+// so unlike PVS it's one-way
+bool G_PlayerCanSee(edict_t *targ, edict_t *from)
+{
+	if (!G_PlayerInPVS(targ, from))
+		return false;
+
+	uint8_t &entry = G_PlayerVisEntry(targ, from);
+
+	if (entry & PLAYER_VIS_LOS_KNOWN)
+	{
+		player_vis_stats.los_reused++;
+		return entry & PLAYER_VIS_LOS;
+	}
+
+	int32_t num_traces = 0;
+	bool visible = loc_CanSee(targ, from, &num_traces);
+
+	player_vis_stats.los_checks++;
+	player_vis_stats.traces += num_traces;
+	player_vis_stats.frame_traces += num_traces;
+
+	entry |= PLAYER_VIS_LOS_KNOWN | (visible ? PLAYER_VIS_LOS : 0);
+
+	return visible;
+}
+
+// anything already worked out is stale once a player moves
+void G_InvalidatePlayerVisibility()
+{
+	player_vis_generation++;
+}
+
+// called once per server frame before the player views are worked out
+void G_PlayerVisibilityFrame()
+{
+	G_InvalidatePlayerVisibility();
+
+	player_vis_stats.frames++;
+	player_vis_stats.peak_frame_traces = max(player_vis_stats.peak_frame_traces, player_vis_stats.frame_traces);
+	player_vis_stats.frame_traces = 0;
+}
+
+void G_PlayerVisibilityReport()
+{
+	const auto &s = player_vis_stats;
+	uint32_t num_players = 0;
+
+	for (auto player : active_players())
+	{
+		(void) player;
+		num_players++;
+	}
+
+	gi.Com_PrintFmt("players={} frames={} pvs_checks={} pvs_reused={} los_checks={} los_reused={} traces={} traces_per_frame={:.2} peak_traces_per_frame={}\n",
+		num_players, s.frames, s.pvs_checks, s.pvs_reused, s.los_checks, s.los_reused, s.traces,
+		s.frames ? (double) s.traces / s.frames : 0.0, s.peak_frame_traces);
+}
+
+// Sarah: every gi.configstring goes through G_ConfigString (see GetGameAPI). A write
+// that matches what the engine already has is dropped, since each one is a reliable
+// broadcast. During a frame, writes are held back so only the last value for each
+// index is flushed at the end of it; G_GetConfigString returns the held-back value
+// so reads see the same thing as before.
+static void (*engine_configstring)(int num, const char *string);
+static const char *(*engine_get_configstring)(int num);
+
+static std::unordered_map<int32_t, std::string> cs_pending;
+static std::vector<int32_t> cs_pending_order;
+
+struct configstring_range_t
+{
+	const char *name;
+	int32_t start, end;
+	uint64_t written = 0, redundant = 0, coalesced = 0;
+};
+
+static configstring_range_t cs_ranges[] = {
+	{ "statusbar", CS_STATUSBAR, CS_AIRACCEL },
+	{ "models", CS_MODELS, CS_SOUNDS },
+	{ "sounds", CS_SOUNDS, CS_IMAGES },
+	{ "images", CS_IMAGES, CS_LIGHTS },
+	{ "lights", CS_LIGHTS, CS_SHADOWLIGHTS },
+	{ "shadowlights", CS_SHADOWLIGHTS, CS_ITEMS },
+	{ "items", CS_ITEMS, CS_PLAYERSKINS },
+	{ "playerskins", CS_PLAYERSKINS, CS_GENERAL },
+	{ "general", CS_GENERAL, CS_WHEEL_WEAPONS },
+	{ "wheel", CS_WHEEL_WEAPONS, CS_CD_LOOP_COUNT },
+	{ "other", 0, MAX_CONFIGSTRINGS }
+};
+
+static configstring_range_t &G_ConfigStringRange(int32_t num)
+{
+	for (auto &range : cs_ranges)
+		if (num >= range.start && num < range.end)
+			return range;
+
+	return cs_ranges[q_countof(cs_ranges) - 1];
+}
+
+// write to the engine if it doesn't already have it
+static void G_WriteConfigString(int32_t num, const char *string)
+{
+	auto &range = G_ConfigStringRange(num);
+	const char *current = engine_get_configstring(num);
+
+	if (current && !strcmp(current, string))
+	{
+		range.redundant++;
+		return;
+	}
+
+	range.written++;
+	engine_configstring(num, string);
+}
+
+static void G_ConfigString(int num, const char *string)
+{
+	if (!string)
+		string = "";
+
+	if (!level.in_frame)
+	{
+		// anything held back for this index is out of date now
+		if (cs_pending.erase(num))
+			cs_pending_order.erase(std::find(cs_pending_order.begin(), cs_pending_order.end(), num));
+
+		G_WriteConfigString(num, string);
+		return;
+	}
+
+	auto it = cs_pending.find(num);
+
+	if (it != cs_pending.end())
+	{
+		G_ConfigStringRange(num).coalesced++;
+		it->second = string;
+		return;
+	}
+
+	cs_pending.emplace(num, string);
+	cs_pending_order.push_back(num);
+}
+
+static const char *G_GetConfigString(int num)
+{
+	auto it = cs_pending.find(num);
+
+	if (it != cs_pending.end())
+		return it->second.c_str();
+
+	return engine_get_configstring(num);
+}
+
+void G_InstallConfigStrings()
+{
+	engine_configstring = gi.configstring;
+	engine_get_configstring = gi.get_configstring;
+	gi.configstring = G_ConfigString;
+	gi.get_configstring = G_GetConfigString;
+}
+
+// called at the end of every frame
+void G_FlushConfigStrings()
+{
+	for (int32_t num : cs_pending_order)
+		G_WriteConfigString(num, cs_pending[num].c_str());
+
+	cs_pending.clear();
+	cs_pending_order.clear();
+}
+
+// Sarah: entity events only last a frame. Rather than G_PrepFrame clearing s.event on every
+// edict, events are set through G_SetEvent, which remembers the entity so just those get
+// cleared. After a level loads everything is cleared once, since the list starts empty.
+// g_validate_events reports any entity holding an event that didn't go through here, and
+// clears it like the old full sweep would have, so a missed write shows up without
+// the event replaying every frame.
+static std::vector<edict_t *> event_entities;
+static bool event_clear_all = true;
+
+void G_SetEvent(edict_t *ent, entity_event_t event)
+{
+	ent->s.event = event;
+
+	if (event != EV_NONE)
+		event_entities.push_back(ent);
+}
+
+// called at the start of every frame
+void G_ClearEvents()
+{
+	if (g_validate_events && g_validate_events->integer && !event_clear_all)
+	{
+		std::sort(event_entities.begin(), event_entities.end());
+
+		for (uint32_t i = 0; i < globals.num_edicts; i++)
+		{
+			edict_t *ent = &g_edicts[i];
+
+			if (ent->s.event != EV_NONE && !std::binary_search(event_entities.begin(), event_entities.end(), ent))
+			{
+				gi.Com_PrintFmt("{}: event {} was set without G_SetEvent\n", *ent, (int32_t) ent->s.event);
+				ent->s.event = EV_NONE;
+			}
+		}
+	}
+
+	if (event_clear_all)
+	{
+		for (uint32_t i = 0; i < globals.num_edicts; i++)
+			g_edicts[i].s.event = EV_NONE;
+
+		event_clear_all = false;
+	}
+	else
+	{
+		for (edict_t *ent : event_entities)
+			ent->s.event = EV_NONE;
+	}
+
+	event_entities.clear();
+}
+
+// entities have been replaced wholesale; clear all of them next frame
+void G_ResetEvents()
+{
+	event_entities.clear();
+	event_clear_all = true;
+}
+
+// Sarah: every gi.Com_Print also goes through the game (see GetGameAPI). Lines are
+// copied into a fixed buffer during a frame and handed to the engine when it ends,
+// so a map spamming warnings costs a memcpy per line instead of a console write.
+// A line identical to one printed within g_log_repeat_window ms is only counted,
+// and printed once with the count when the window closes; after that, at most
+// g_log_rate distinct lines go out per second. g_log_file, if set, gets a copy.
+// Outside of a frame (server commands, loading) lines are never filtered.
+// Nothing here formats with G_Fmt, since the text being logged usually lives in its buffers.
+static void (*engine_com_print)(const char *msg);
+static void (*engine_com_error)(const char *msg);
+
+constexpr size_t LOG_MAX_LINES = 1024;
+constexpr size_t LOG_MAX_TEXT = 0x40000;
+constexpr size_t LOG_MAX_RECENT = 4096;
+
+struct log_line_t
+{
+	size_t offset, length;
+};
+
+struct log_recent_t
+{
+	std::string text;
+	int64_t printed;
+	uint32_t repeats;
+};
+
+static struct
+{
+	log_line_t lines[LOG_MAX_LINES];
+	size_t num_lines;
+	char text[LOG_MAX_TEXT];
+	size_t text_used;
+
+	std::unordered_map<size_t, log_recent_t> recent;
+
+	int64_t rate_window;
+	uint32_t rate_lines, rate_dropped;
+
+	FILE *file;
+	std::string file_name;
+
+	uint64_t printed, repeated, dropped, flushes;
+	size_t peak_lines;
+} g_log;
+
+static int64_t G_LogTime()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void G_LogOpenFile()
+{
+	const char *name = g_log_file ? g_log_file->string : "";
+
+	if (g_log.file_name == name)
+		return;
+
+	if (g_log.file)
+		fclose(g_log.file);
+
+	g_log.file = nullptr;
+	g_log.file_name = name;
+
+	if (*name)
+	{
+		g_log.file = fopen(fmt::format("./{}/{}", gi.cvar("gamedir", "", CVAR_NOFLAGS)->string, name).c_str(), "a");
+
+		if (!g_log.file)
+			engine_com_print(fmt::format("Couldn't open log file {}\n", name).c_str());
+	}
+}
+
+static void G_LogWrite(const char *msg)
+{
+	g_log.printed++;
+	engine_com_print(msg);
+
+	if (g_log.file)
+		fputs(msg, g_log.file);
+}
+
+// send everything held back to the engine
+static void G_LogDrain()
+{
+	G_LogOpenFile();
+
+	// G_LogWrite needs a terminated string, and the lines are packed back to back
+	static std::string line_buffer;
+
+	for (size_t i = 0; i < g_log.num_lines; i++)
+	{
+		const auto &line = g_log.lines[i];
+		line_buffer.assign(g_log.text + line.offset, line.length);
+		G_LogWrite(line_buffer.c_str());
+	}
+
+	if (g_log.num_lines)
+		g_log.flushes++;
+
+	g_log.num_lines = 0;
+	g_log.text_used = 0;
+
+	if (g_log.file)
+		fflush(g_log.file);
+}
+
+// copy a line in to be sent at the end of the frame
+static void G_LogQueue(std::string_view text)
+{
+	// out of room; make some
+	if (g_log.num_lines == LOG_MAX_LINES || g_log.text_used + text.size() > LOG_MAX_TEXT)
+		G_LogDrain();
+
+	// too big to hold, just send it
+	if (text.size() > LOG_MAX_TEXT)
+	{
+		G_LogWrite(std::string(text).c_str());
+		return;
+	}
+
+	auto &line = g_log.lines[g_log.num_lines++];
+	line.offset = g_log.text_used;
+	line.length = text.size();
+	memcpy(g_log.text + g_log.text_used, text.data(), text.size());
+	g_log.text_used += text.size();
+
+	g_log.peak_lines = max(g_log.peak_lines, g_log.num_lines);
+}
+
+static void G_LogQueueRepeats(const log_recent_t &recent)
+{
+	std::string_view text = recent.text;
+
+	while (!text.empty() && text.back() == '\n')
+		text.remove_suffix(1);
+
+	G_LogQueue(fmt::format("{} (repeated {} times)\n", text, recent.repeats));
+}
+
+static void G_ComPrint(const char *msg)
+{
+	if (!msg || !*msg)
+		return;
+
+	// outside of a frame it's admin commands and loading; that goes straight out, unfiltered,
+	// after anything still held back
+	if (!level.in_frame)
+	{
+		G_LogDrain();
+		G_LogWrite(msg);
+		return;
+	}
+
+	std::string_view text = msg;
+	int64_t now = G_LogTime();
+	int64_t window = g_log_repeat_window ? g_log_repeat_window->integer : 0;
+	size_t hash = std::hash<std::string_view>()(text);
+	auto recent = window > 0 ? g_log.recent.find(hash) : g_log.recent.end();
+
+	if (recent != g_log.recent.end() && recent->second.text == text && now - recent->second.printed < window)
+	{
+		recent->second.repeats++;
+		g_log.repeated++;
+		return;
+	}
+
+	int32_t rate = g_log_rate ? g_log_rate->integer : 0;
+
+	if (rate > 0)
+	{
+		if (now - g_log.rate_window >= 1000)
+		{
+			g_log.rate_window = now;
+			g_log.rate_lines = 0;
+		}
+
+		if (g_log.rate_lines >= (uint32_t) rate)
+		{
+			g_log.rate_dropped++;
+			g_log.dropped++;
+			return;
+		}
+
+		g_log.rate_lines++;
+	}
+
+	if (recent != g_log.recent.end())
+	{
+		// a different line with the same hash just takes the slot over
+		if (recent->second.repeats)
+			G_LogQueueRepeats(recent->second);
+
+		recent->second = { std::string(text), now, 0 };
+	}
+	else if (window > 0 && g_log.recent.size() < LOG_MAX_RECENT)
+		g_log.recent.emplace(hash, log_recent_t { std::string(text), now, 0 });
+
+	G_LogQueue(text);
+}
+
+// anything held back has to go out before the engine unwinds
+static void G_ComError(const char *msg)
+{
+	G_FlushLog();
+	engine_com_error(msg);
+}
+
+void G_InstallLogging()
+{
+	engine_com_print = gi.Com_Print;
+	engine_com_error = gi.Com_Error;
+	gi.Com_Print = G_ComPrint;
+	gi.Com_Error = G_ComError;
+}
+
+// called at the end of every frame
+void G_FlushLog()
+{
+	if (!engine_com_print)
+		return;
+
+	int64_t now = G_LogTime();
+	int64_t window = g_log_repeat_window ? g_log_repeat_window->integer : 0;
+
+	// lines whose window has closed report how often they were held back
+	for (auto it = g_log.recent.begin(); it != g_log.recent.end(); )
+	{
+		if (window > 0 && now - it->second.printed < window)
+		{
+			++it;
+			continue;
+		}
+
+		if (it->second.repeats)
+			G_LogQueueRepeats(it->second);
+
+		it = g_log.recent.erase(it);
+	}
+
+	if (g_log.rate_dropped && now - g_log.rate_window >= 1000)
+	{
+		G_LogQueue(fmt::format("{} lines dropped by g_log_rate\n", g_log.rate_dropped));
+		g_log.rate_dropped = 0;
+	}
+
+	G_LogDrain();
+}
+
+void G_ShutdownLogging()
+{
+	if (!engine_com_print)
+		return;
+
+	// report whatever was still being counted
+	for (auto &[hash, recent] : g_log.recent)
+		if (recent.repeats)
+			G_LogQueueRepeats(recent);
+
+	g_log.recent.clear();
+
+	if (g_log.rate_dropped)
+	{
+		G_LogQueue(fmt::format("{} lines dropped by g_log_rate\n", g_log.rate_dropped));
+		g_log.rate_dropped = 0;
+	}
+
+	G_LogDrain();
+
+	if (g_log.file)
+		fclose(g_log.file);
+
+	g_log.file = nullptr;
+	g_log.file_name.clear();
+}
+
+void G_LogReport()
+{
+	gi.Com_PrintFmt("printed={} repeated={} dropped={} flushes={} peak_lines={} tracked={} file={}\n",
+		g_log.printed, g_log.repeated, g_log.dropped, g_log.flushes, g_log.peak_lines, g_log.recent.size(),
+		g_log.file ? g_log.file_name.c_str() : "none");
+}
+
+void G_ConfigStringReport()
+{
+	for (auto &range : cs_ranges)
+		if (range.written || range.redundant || range.coalesced)
+			gi.Com_PrintFmt("{}: {} written, {} redundant, {} coalesced\n", range.name, range.written, range.redundant, range.coalesced);
+}
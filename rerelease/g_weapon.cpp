@@ -245,7 +245,9 @@ fire_lead
 This is an internal support routine used for bullet/pellet based weapons.
 =================
 */
-static void fire_lead(edict_t *self, const vec3_t &start, const vec3_t &aimdir, int damage, int kick, int te_impact, int hspread, int vspread, mod_t mod)
+// Sarah: spread is an optional pair of [-1, 1) values for the pellet's offset, so
+// spread patterns can be generated all at once
+static void fire_lead(edict_t *self, const vec3_t &start, const vec3_t &aimdir, int damage, int kick, int te_impact, int hspread, int vspread, mod_t mod, const float *spread = nullptr)
 {
 	fire_lead_pierce_t args = {
 		self,
@@ -284,8 +286,8 @@ static void fire_lead(edict_t *self, const vec3_t &start, const vec3_t &aimdir,
 		dir = vectoangles(aimdir);
 		AngleVectors(dir, forward, right, up);
 
-		float r = crandom() * hspread;
-		float u = crandom() * vspread;
+		float r = (spread ? spread[0] : crandom()) * hspread;
+		float u = (spread ? spread[1] : crandom()) * vspread;
 		end = start + (forward * 8192);
 		end += (right * r);
 		end += (up * u);
@@ -339,8 +341,19 @@ Shoots shotgun pellets.  Used by shotgun and super shotgun.
 */
 void fire_shotgun(edict_t *self, const vec3_t &start, const vec3_t &aimdir, int damage, int kick, int hspread, int vspread, int count, mod_t mod)
 {
-	for (int i = 0; i < count; i++)
-		fire_lead(self, start, aimdir, damage, kick, TE_SHOTGUN, hspread, vspread, mod);
+	// Sarah: the spread pattern is generated in batches
+	constexpr int MAX_SPREAD_BATCH = 32;
+	float spread[MAX_SPREAD_BATCH * 2];
+
+	for (int i = 0; i < count; i += MAX_SPREAD_BATCH)
+	{
+		int batch = min(count - i, MAX_SPREAD_BATCH);
+
+		rng_gameplay.crandom_fill(spread, batch * 2);
+
+		for (int j = 0; j < batch; j++)
+			fire_lead(self, start, aimdir, damage, kick, TE_SHOTGUN, hspread, vspread, mod, &spread[j * 2]);
+	}
 }
 
 /*
@@ -981,10 +981,12 @@ float PlayersRangeFromSpot(edict_t *spot)
 {
 	edict_t *player;
 	float	 bestplayerdistance;
-	vec3_t	 v;
-	float	 playerdistance;
 
-	bestplayerdistance = 9999999;
+	// Sarah: distances are worked out in batches, and only the closest is square rooted
+	static vec3_batch_t<MAX_CLIENTS> origins;
+	alignas(16) static float dist[MAX_CLIENTS];
+
+	origins.clear();
 
 	for (uint32_t n = 1; n <= game.maxclients; n++)
 	{
@@ -996,11 +998,21 @@ float PlayersRangeFromSpot(edict_t *spot)
 		if (player->health <= 0)
 			continue;
 
-		v = spot->s.origin - player->s.origin;
-		playerdistance = v.length();
+		origins.push(player->s.origin);
+	}
+
+	vec3_batch_distance_squared(origins, spot->s.origin, dist);
+
+	bestplayerdistance = 9999999;
 
-		if (playerdistance < bestplayerdistance)
-			bestplayerdistance = playerdistance;
+	if (origins.count)
+	{
+		float best_squared = dist[0];
+
+		for (size_t i = 1; i < origins.count; i++)
+			best_squared = min(best_squared, dist[i]);
+
+		bestplayerdistance = min(bestplayerdistance, sqrtf(best_squared));
 	}
 
 	return bestplayerdistance;
@@ -1087,7 +1099,7 @@ select_spawn_result_t SelectDeathmatchSpawnPoint(bool farthest, bool force_spawn
 		// for random, select a random point other than the two
 		// that are closest to the player if possible.
 		// shuffle the non-distance-related spawn points
-		std::shuffle(spawn_points.begin() + 2, spawn_points.end(), mt_rand);
+		std::shuffle(spawn_points.begin() + 2, spawn_points.end(), rng_gameplay);
 
 		// run down the list and pick the first one that we can use
 		for (auto it = spawn_points.begin() + 2; it != spawn_points.end(); ++it)
@@ -1583,7 +1595,7 @@ void CopyToBodyQue(edict_t *ent)
 	body->movetype = ent->movetype;
 	body->health = ent->health;
 	body->gib_health = ent->gib_health;
-	body->s.event = EV_OTHER_TELEPORT;
+	G_SetEvent(body, EV_OTHER_TELEPORT);
 	body->velocity = ent->velocity;
 	body->avelocity = ent->avelocity;
 	body->groundentity = ent->groundentity;
@@ -1609,7 +1621,7 @@ void G_PostRespawn(edict_t *self)
 		return;
 
 	// add a teleportation effect
-	self->s.event = EV_PLAYER_TELEPORT;
+	G_SetEvent(self, EV_PLAYER_TELEPORT);
 
 	// hold in place briefly
 	self->client->ps.pmove.pm_flags = PMF_TIME_TELEPORT;
@@ -2474,6 +2486,9 @@ void ClientBegin(edict_t *ent)
 	// [Paril-KEX] we're always connected by this point...
 	ent->client->pers.connected = true;
 
+	// Sarah: whatever layout they had before, they don't have it now
+	G_InvalidateLayout(ent);
+
 	if (deathmatch->integer)
 	{
 		ClientBeginDeathmatch(ent);
@@ -3070,7 +3085,7 @@ void P_FallingDamage(edict_t *ent, const pmove_t &pm)
 	if (delta < 15)
 	{
 		if (!(pm.s.pm_flags & PMF_ON_LADDER))
-			ent->s.event = EV_FOOTSTEP;
+			G_SetEvent(ent, EV_FOOTSTEP);
 		return;
 	}
 
@@ -3082,9 +3097,9 @@ void P_FallingDamage(edict_t *ent, const pmove_t &pm)
 	if (delta > 30)
 	{
 		if (delta >= 55)
-			ent->s.event = EV_FALLFAR;
+			G_SetEvent(ent, EV_FALLFAR);
 		else
-			ent->s.event = EV_FALL;
+			G_SetEvent(ent, EV_FALL);
 
 		ent->pain_debounce_time = level.time + FRAME_TIME_S; // no normal pain sound
 		damage = (int) ((delta - 30) / 2);
@@ -3096,7 +3111,7 @@ void P_FallingDamage(edict_t *ent, const pmove_t &pm)
 			T_Damage(ent, world, world, dir, ent->s.origin, vec3_origin, damage, 0, DAMAGE_NONE, MOD_FALLING);
 	}
 	else
-		ent->s.event = EV_FALLSHORT;
+		G_SetEvent(ent, EV_FALLSHORT);
 
 	// Paril: falling damage noises alert monsters
 	if (ent->health)
@@ -3154,6 +3169,9 @@ void ClientThink(edict_t *ent, usercmd_t *ucmd)
 	level.current_entity = ent;
 	client = ent->client;
 
+	// Sarah: this player is about to move
+	G_InvalidatePlayerVisibility();
+
 	// [Paril-KEX] pass buttons through even if we are in intermission or
 	// chasing.
 	client->oldbuttons = client->buttons;
@@ -3297,7 +3315,7 @@ void ClientThink(edict_t *ent, usercmd_t *ucmd)
 				if (!deathmatch->integer && 
 					client->last_ladder_sound < level.time)
 				{
-					ent->s.event = EV_LADDER_STEP;
+					G_SetEvent(ent, EV_LADDER_STEP);
 					client->last_ladder_sound = level.time + LADDER_SOUND_TIME;
 				}
 			}
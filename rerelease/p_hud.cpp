@@ -17,7 +17,7 @@ void MoveClientToIntermission(edict_t *ent)
 {
 	// [Paril-KEX]
 	if (ent->client->ps.pmove.pm_type != PM_FREEZE)
-		ent->s.event = EV_OTHER_TELEPORT;
+		G_SetEvent(ent, EV_OTHER_TELEPORT);
 	if (deathmatch->integer)
 		ent->client->showscores = true;
 	ent->s.origin = level.intermission_origin;
@@ -167,7 +167,10 @@ void G_EndOfUnitMessage()
 	gi.multicast(vec3_origin, MULTICAST_ALL, true);
 
 	for (auto player : active_players())
+	{
 		player->client->showeou = true;
+		G_InvalidateLayout(player);
+	}
 }
 
 // data is binary now.
@@ -398,13 +401,74 @@ void BeginIntermission(edict_t *targ)
 
 constexpr size_t MAX_SCOREBOARD_SIZE = 1024;
 
+/*
+==================
+G_WriteLayout
+
+Sarah: writes a layout for a unicast to ent. Refreshes of a layout that
+hasn't changed since the last one the client was sent are skipped, and
+false is returned so the caller doesn't send anything. Since refreshes
+are usually unreliable, an unchanged layout is still sent now and then
+in case the last one was dropped.
+==================
+*/
+constexpr gtime_t LAYOUT_RESEND_TIME = 10_sec;
+
+static uint64_t layouts_sent, layouts_skipped, layout_bytes_saved;
+
+bool G_WriteLayout(edict_t *ent, const char *layout, bool refresh)
+{
+	auto &sent = ent->client->layout_sent;
+	size_t length = strlen(layout);
+	uint64_t hash = 0xcbf29ce484222325ull;
+
+	for (size_t i = 0; i < length; i++)
+		hash = (hash ^ (uint8_t) layout[i]) * 0x100000001b3ull;
+
+	if (refresh && sent.valid && sent.hash == hash && sent.length == length && level.time < sent.time + LAYOUT_RESEND_TIME)
+	{
+		// svc_layout, the string and its terminator
+		sent.skipped++;
+		sent.bytes_saved += length + 2;
+		layouts_skipped++;
+		layout_bytes_saved += length + 2;
+		return false;
+	}
+
+	gi.WriteByte(svc_layout);
+	gi.WriteString(layout);
+
+	sent.valid = true;
+	sent.hash = hash;
+	sent.length = length;
+	sent.time = level.time;
+	layouts_sent++;
+
+	return true;
+}
+
+// Sarah: the client was sent a layout some other way
+void G_InvalidateLayout(edict_t *ent)
+{
+	ent->client->layout_sent.valid = false;
+}
+
+void G_LayoutReport()
+{
+	gi.Com_PrintFmt("layouts: {} sent, {} skipped, {} bytes saved\n", layouts_sent, layouts_skipped, layout_bytes_saved);
+
+	for (auto player : active_players())
+		gi.Com_PrintFmt("  {}: {} skipped, {} bytes saved\n", player->client->pers.netname, player->client->layout_sent.skipped, player->client->layout_sent.bytes_saved);
+}
+
 /*
 ==================
 DeathmatchScoreboardMessage
 
+Sarah: returns false if it was a refresh that didn't need sending
 ==================
 */
-void DeathmatchScoreboardMessage(edict_t *ent, edict_t *killer)
+bool DeathmatchScoreboardMessage(edict_t *ent, edict_t *killer, bool refresh)
 {
 	static std::string entry, string;
 	size_t		j;
@@ -418,10 +482,7 @@ void DeathmatchScoreboardMessage(edict_t *ent, edict_t *killer)
 
 	// ZOID
 	if (G_TeamplayEnabled())
-	{
-		CTFScoreboardMessage(ent, killer);
-		return;
-	}
+		return CTFScoreboardMessage(ent, killer, refresh);
 	// ZOID
 
 	entry.clear();
@@ -523,8 +584,7 @@ void DeathmatchScoreboardMessage(edict_t *ent, edict_t *killer)
 	if (level.intermissiontime)
 		fmt::format_to(std::back_inserter(string), FMT_STRING("ifgef {} yb -48 xv 0 loc_cstring2 0 \"$m_eou_press_button\" endif "), (level.intermission_server_frame + (5_sec).frames()));
 
-	gi.WriteByte(svc_layout);
-	gi.WriteString(string.c_str());
+	return G_WriteLayout(ent, string.c_str(), refresh);
 }
 
 /*
@@ -645,8 +705,7 @@ void HelpComputer(edict_t *ent)
 		level.killed_monsters, level.total_monsters,
 		level.found_secrets, level.total_secrets);
 
-	gi.WriteByte(svc_layout);
-	gi.WriteString(helpString.c_str());
+	G_WriteLayout(ent, helpString.c_str(), false);
 	gi.unicast(ent, true);
 }
 
@@ -722,28 +781,53 @@ struct powerup_info_t
 	{ IT_ITEM_SILENCER, nullptr, &gclient_t::silencer_shots }
 };
 
-/*
-===============
-G_SetStats
-===============
-*/
-void G_SetStats(edict_t *ent)
+// Sarah: the inventory-derived stats are worked out by G_SetInventoryStats into the client's
+// stats cache, only when one of the inputs it copies changes. The cache's outputs are still
+// written to ps.stats every frame, since chasing spectators get the stats copied over theirs.
+static uint32_t stats_cache_generation = 1;
+static uint64_t stats_recomputed, stats_reused, stats_mismatched;
+
+// image indices may have changed, so work everything out again
+void G_InvalidateStatsCache()
+{
+	stats_cache_generation++;
+}
+
+void G_StatsCacheReport()
+{
+	gi.Com_PrintFmt("stats: {} recomputed, {} reused, {} validation mismatches\n", stats_recomputed, stats_reused, stats_mismatched);
+}
+
+static void G_CopyStatsInputs(edict_t *ent, client_stats_cache_t &cache)
+{
+	cache.inventory = ent->client->pers.inventory;
+	cache.weapon = ent->client->pers.weapon;
+	cache.newweapon = ent->client->newweapon;
+	cache.power_armor = !!(ent->flags & FL_POWER_ARMOR);
+	cache.flashlight = !!(ent->flags & FL_FLASHLIGHT);
+	cache.selected_item = ent->client->pers.selected_item;
+	cache.hand = ent->client->pers.hand;
+	cache.infinite_ammo = g_infinite_ammo->integer || (deathmatch->integer && g_instagib->integer);
+}
+
+static bool G_StatsInputsChanged(edict_t *ent, const client_stats_cache_t &cache)
+{
+	return cache.generation != stats_cache_generation ||
+		cache.weapon != ent->client->pers.weapon ||
+		cache.newweapon != ent->client->newweapon ||
+		cache.power_armor != !!(ent->flags & FL_POWER_ARMOR) ||
+		cache.flashlight != !!(ent->flags & FL_FLASHLIGHT) ||
+		cache.selected_item != ent->client->pers.selected_item ||
+		cache.hand != ent->client->pers.hand ||
+		cache.infinite_ammo != (g_infinite_ammo->integer || (deathmatch->integer && g_instagib->integer)) ||
+		cache.inventory != ent->client->pers.inventory;
+}
+
+static void G_SetInventoryStats(edict_t *ent, client_stats_cache_t &cache)
 {
 	gitem_t	*item;
-	item_id_t index;
-	int		  cells = 0;
-	item_id_t power_armor_type;
 	unsigned int invIndex;
 
-	//
-	// health
-	//
-	if (ent->s.renderfx & RF_USE_DISGUISE)
-		ent->client->ps.stats[STAT_HEALTH_ICON] = level.disguise_icon;
-	else
-		ent->client->ps.stats[STAT_HEALTH_ICON] = level.pic_health;
-	ent->client->ps.stats[STAT_HEALTH] = ent->health;
-
 	//
 	// weapons
 	//
@@ -757,19 +841,19 @@ void G_SetStats(edict_t *ent)
 		}
 	}
 
-	ent->client->ps.stats[STAT_WEAPONS_OWNED_1] = (weaponbits & 0xFFFF);
-	ent->client->ps.stats[STAT_WEAPONS_OWNED_2] = (weaponbits >> 16);
+	cache.weapons_owned_1 = (weaponbits & 0xFFFF);
+	cache.weapons_owned_2 = (weaponbits >> 16);
 
-	ent->client->ps.stats[STAT_ACTIVE_WHEEL_WEAPON] = (ent->client->newweapon ? ent->client->newweapon->weapon_wheel_index :
+	cache.active_wheel_weapon = (ent->client->newweapon ? ent->client->newweapon->weapon_wheel_index :
 		ent->client->pers.weapon ? ent->client->pers.weapon->weapon_wheel_index :
 		-1);
-	ent->client->ps.stats[STAT_ACTIVE_WEAPON] = ent->client->pers.weapon ? ent->client->pers.weapon->weapon_wheel_index : -1;
+	cache.active_weapon = ent->client->pers.weapon ? ent->client->pers.weapon->weapon_wheel_index : -1;
 
 	//
 	// ammo
 	//
-	ent->client->ps.stats[STAT_AMMO_ICON] = 0;
-	ent->client->ps.stats[STAT_AMMO] = 0;
+	cache.ammo_icon = 0;
+	cache.ammo = 0;
 
 	if (ent->client->pers.weapon && ent->client->pers.weapon->ammo)
 	{
@@ -777,55 +861,45 @@ void G_SetStats(edict_t *ent)
 
 		if (!G_CheckInfiniteAmmo(item))
 		{
-			ent->client->ps.stats[STAT_AMMO_ICON] = gi.imageindex(item->icon);
-			ent->client->ps.stats[STAT_AMMO] = ent->client->pers.inventory[ent->client->pers.weapon->ammo];
+			cache.ammo_icon = gi.imageindex(item->icon);
+			cache.ammo = ent->client->pers.inventory[ent->client->pers.weapon->ammo];
 		}
 	}
 	
-	memset(&ent->client->ps.stats[STAT_AMMO_INFO_START], 0, sizeof(uint16_t) * NUM_AMMO_STATS);
+	cache.ammo_info = {};
 	for (unsigned int ammoIndex = AMMO_BULLETS; ammoIndex < AMMO_MAX; ++ammoIndex)
 	{
 		gitem_t *ammo = GetItemByAmmo((ammo_t) ammoIndex);
 		uint16_t val = G_CheckInfiniteAmmo(ammo) ? AMMO_VALUE_INFINITE : clamp(ent->client->pers.inventory[ammo->id], 0, AMMO_VALUE_INFINITE - 1);
-		G_SetAmmoStat((uint16_t *) &ent->client->ps.stats[STAT_AMMO_INFO_START], ammo->ammo_wheel_index, val);
+		G_SetAmmoStat((uint16_t *) cache.ammo_info.data(), ammo->ammo_wheel_index, val);
 	}
 
 	//
-	// armor
+	// armor; which one is shown flashes, so that's left to G_SetStats
 	//
-	power_armor_type = PowerArmorType(ent);
-	if (power_armor_type)
-		cells = ent->client->pers.inventory[IT_AMMO_CELLS];
+	cache.power_armor_type = PowerArmorType(ent);
+	cache.power_armor_icon = 0;
+	cache.power_armor_cells = 0;
 
-	index = ArmorIndex(ent);
-	if (power_armor_type && (!index || (level.time.milliseconds() % 3000) < 1500))
-	{ // flash between power armor and other armor icon
-		ent->client->ps.stats[STAT_ARMOR_ICON] = power_armor_type == IT_ITEM_POWER_SHIELD ? gi.imageindex("i_powershield") : gi.imageindex("i_powerscreen");
-		ent->client->ps.stats[STAT_ARMOR] = cells;
-	}
-	else if (index)
+	if (cache.power_armor_type)
 	{
-		item = GetItemByIndex(index);
-		ent->client->ps.stats[STAT_ARMOR_ICON] = gi.imageindex(item->icon);
-		ent->client->ps.stats[STAT_ARMOR] = ent->client->pers.inventory[index];
-	}
-	else
-	{
-		ent->client->ps.stats[STAT_ARMOR_ICON] = 0;
-		ent->client->ps.stats[STAT_ARMOR] = 0;
+		cache.power_armor_icon = cache.power_armor_type == IT_ITEM_POWER_SHIELD ? gi.imageindex("i_powershield") : gi.imageindex("i_powerscreen");
+		cache.power_armor_cells = ent->client->pers.inventory[IT_AMMO_CELLS];
 	}
 
-	//
-	// pickup message
-	//
-	if (level.time > ent->client->pickup_msg_time)
+	cache.armor_index = ArmorIndex(ent);
+	cache.armor_icon = 0;
+	cache.armor_count = 0;
+
+	if (cache.armor_index)
 	{
-		ent->client->ps.stats[STAT_PICKUP_ICON] = 0;
-		ent->client->ps.stats[STAT_PICKUP_STRING] = 0;
+		item = GetItemByIndex(cache.armor_index);
+		cache.armor_icon = gi.imageindex(item->icon);
+		cache.armor_count = ent->client->pers.inventory[cache.armor_index];
 	}
 
 	// owned powerups
-	memset(&ent->client->ps.stats[STAT_POWERUP_INFO_START], 0, sizeof(uint16_t) * NUM_POWERUP_STATS);
+	cache.powerup_info = {};
 	for (unsigned int powerupIndex = POWERUP_SCREEN; powerupIndex < POWERUP_MAX; ++powerupIndex)
 	{
 		gitem_t *powerup = GetItemByPowerup((powerup_t) powerupIndex);
@@ -855,9 +929,154 @@ void G_SetStats(edict_t *ent)
 			break;
 		}
 
-		G_SetPowerupStat((uint16_t *) &ent->client->ps.stats[STAT_POWERUP_INFO_START], powerup->powerup_wheel_index, val);
+		G_SetPowerupStat((uint16_t *) cache.powerup_info.data(), powerup->powerup_wheel_index, val);
 	}
 
+	//
+	// selected item
+	//
+	if (ent->client->pers.selected_item == IT_NULL)
+		cache.selected_icon = 0;
+	else
+		cache.selected_icon = gi.imageindex(itemlist[ent->client->pers.selected_item].icon);
+
+	// [Paril-KEX] keys held; which ones are shown cycles, so that's left to G_SetStats
+	cache.num_keys = 0;
+
+	if (!deathmatch->integer)
+	{
+		for (auto &item : itemlist)
+		{
+			if (!(item.flags & IF_KEY))
+				continue;
+			else if (!ent->client->pers.inventory[item.id])
+				continue;
+
+			cache.key_icons[cache.num_keys++] = gi.imageindex(item.icon);
+		}
+	}
+
+	// current weapon for the help icon
+	if ((ent->client->pers.hand == CENTER_HANDED) && ent->client->pers.weapon)
+		cache.weapon_icon = gi.imageindex(ent->client->pers.weapon->icon);
+	else
+		cache.weapon_icon = 0;
+
+	// worked out by SetCTFStats
+	cache.ctf_tech_icon = 0;
+}
+
+// check a freshly worked out cache against the one in use
+static void G_ValidateInventoryStats(edict_t *ent)
+{
+	static client_stats_cache_t check;
+	const client_stats_cache_t &cache = ent->client->stats_cache;
+
+	G_SetInventoryStats(ent, check);
+
+	bool valid = cache.weapons_owned_1 == check.weapons_owned_1 &&
+		cache.weapons_owned_2 == check.weapons_owned_2 &&
+		cache.active_wheel_weapon == check.active_wheel_weapon &&
+		cache.active_weapon == check.active_weapon &&
+		cache.ammo_icon == check.ammo_icon &&
+		cache.ammo == check.ammo &&
+		cache.ammo_info == check.ammo_info &&
+		cache.powerup_info == check.powerup_info &&
+		cache.power_armor_type == check.power_armor_type &&
+		cache.power_armor_icon == check.power_armor_icon &&
+		cache.power_armor_cells == check.power_armor_cells &&
+		cache.armor_index == check.armor_index &&
+		cache.armor_icon == check.armor_icon &&
+		cache.armor_count == check.armor_count &&
+		cache.selected_icon == check.selected_icon &&
+		cache.weapon_icon == check.weapon_icon &&
+		cache.num_keys == check.num_keys &&
+		std::equal(cache.key_icons.begin(), cache.key_icons.begin() + cache.num_keys, check.key_icons.begin());
+
+	if (!valid)
+	{
+		stats_mismatched++;
+		gi.Com_PrintFmt("G_SetStats: cached stats for {} don't match a full recompute\n", *ent);
+	}
+}
+
+/*
+===============
+G_SetStats
+===============
+*/
+void G_SetStats(edict_t *ent)
+{
+	client_stats_cache_t &cache = ent->client->stats_cache;
+
+	// Sarah: only recompute the inventory-derived stats when something they use changed
+	cache.changed = G_StatsInputsChanged(ent, cache);
+
+	if (cache.changed)
+	{
+		stats_recomputed++;
+		G_CopyStatsInputs(ent, cache);
+		G_SetInventoryStats(ent, cache);
+		cache.generation = stats_cache_generation;
+	}
+	else
+	{
+		stats_reused++;
+
+		if (g_validate_stats->integer)
+			G_ValidateInventoryStats(ent);
+	}
+
+	//
+	// health
+	//
+	if (ent->s.renderfx & RF_USE_DISGUISE)
+		ent->client->ps.stats[STAT_HEALTH_ICON] = level.disguise_icon;
+	else
+		ent->client->ps.stats[STAT_HEALTH_ICON] = level.pic_health;
+	ent->client->ps.stats[STAT_HEALTH] = ent->health;
+
+	//
+	// weapons
+	//
+	ent->client->ps.stats[STAT_WEAPONS_OWNED_1] = cache.weapons_owned_1;
+	ent->client->ps.stats[STAT_WEAPONS_OWNED_2] = cache.weapons_owned_2;
+	ent->client->ps.stats[STAT_ACTIVE_WHEEL_WEAPON] = cache.active_wheel_weapon;
+	ent->client->ps.stats[STAT_ACTIVE_WEAPON] = cache.active_weapon;
+
+	//
+	// ammo
+	//
+	ent->client->ps.stats[STAT_AMMO_ICON] = cache.ammo_icon;
+	ent->client->ps.stats[STAT_AMMO] = cache.ammo;
+	memcpy(&ent->client->ps.stats[STAT_AMMO_INFO_START], cache.ammo_info.data(), sizeof(uint16_t) * NUM_AMMO_STATS);
+
+	//
+	// armor
+	//
+	if (cache.power_armor_type && (!cache.armor_index || (level.time.milliseconds() % 3000) < 1500))
+	{ // flash between power armor and other armor icon
+		ent->client->ps.stats[STAT_ARMOR_ICON] = cache.power_armor_icon;
+		ent->client->ps.stats[STAT_ARMOR] = cache.power_armor_cells;
+	}
+	else
+	{
+		ent->client->ps.stats[STAT_ARMOR_ICON] = cache.armor_icon;
+		ent->client->ps.stats[STAT_ARMOR] = cache.armor_count;
+	}
+
+	//
+	// pickup message
+	//
+	if (level.time > ent->client->pickup_msg_time)
+	{
+		ent->client->ps.stats[STAT_PICKUP_ICON] = 0;
+		ent->client->ps.stats[STAT_PICKUP_STRING] = 0;
+	}
+
+	// owned powerups
+	memcpy(&ent->client->ps.stats[STAT_POWERUP_INFO_START], cache.powerup_info.data(), sizeof(uint16_t) * NUM_POWERUP_STATS);
+
 	ent->client->ps.stats[STAT_TIMER_ICON] = 0;
 	ent->client->ps.stats[STAT_TIMER] = 0;
 
@@ -929,16 +1148,10 @@ void G_SetStats(edict_t *ent)
 	// selected item
 	//
 	ent->client->ps.stats[STAT_SELECTED_ITEM] = ent->client->pers.selected_item;
+	ent->client->ps.stats[STAT_SELECTED_ICON] = cache.selected_icon;
 
-	if (ent->client->pers.selected_item == IT_NULL)
-		ent->client->ps.stats[STAT_SELECTED_ICON] = 0;
-	else
-	{
-		ent->client->ps.stats[STAT_SELECTED_ICON] = gi.imageindex(itemlist[ent->client->pers.selected_item].icon);
-
-		if (ent->client->pers.selected_item_time < level.time)
-			ent->client->ps.stats[STAT_SELECTED_ITEM_NAME] = 0;
-	}
+	if (ent->client->pers.selected_item != IT_NULL && ent->client->pers.selected_item_time < level.time)
+		ent->client->ps.stats[STAT_SELECTED_ITEM_NAME] = 0;
 
 	//
 	// layouts
@@ -988,26 +1201,14 @@ void G_SetStats(edict_t *ent)
 		ent->client->ps.stats[STAT_KEY_B] = 
 		ent->client->ps.stats[STAT_KEY_C] = 0;
 
-		// there's probably a way to do this in one pass but
-		// I'm lazy
-		std::array<item_id_t, IT_TOTAL> keys_held;
-		size_t num_keys_held = 0;
-
-		for (auto &item : itemlist)
-		{
-			if (!(item.flags & IF_KEY))
-				continue;
-			else if (!ent->client->pers.inventory[item.id])
-				continue;
-
-			keys_held[num_keys_held++] = item.id;
-		}
+		// Sarah: the keys held come from the stats cache
+		size_t num_keys_held = cache.num_keys;
 
 		if (num_keys_held > 3)
 			key_offset = (int32_t) (level.time.seconds() / 5);
 
 		for (int32_t i = 0; i < min(num_keys_held, (size_t) 3); i++, stat = (player_stat_t) (stat + 1))
-			ent->client->ps.stats[stat] = gi.imageindex(GetItemByIndex(keys_held[(i + key_offset) % num_keys_held])->icon);
+			ent->client->ps.stats[stat] = cache.key_icons[(i + key_offset) % num_keys_held];
 	}
 
 	//
@@ -1020,10 +1221,8 @@ void G_SetStats(edict_t *ent)
 	//
 	if (ent->client->pers.helpchanged >= 1 && ent->client->pers.helpchanged <= 2 && (level.time.milliseconds() % 1000) < 500) // haleyjd: time-limited
 		ent->client->ps.stats[STAT_HELPICON] = gi.imageindex("i_help");
-	else if ((ent->client->pers.hand == CENTER_HANDED) && ent->client->pers.weapon)
-		ent->client->ps.stats[STAT_HELPICON] = gi.imageindex(ent->client->pers.weapon->icon);
 	else
-		ent->client->ps.stats[STAT_HELPICON] = 0;
+		ent->client->ps.stats[STAT_HELPICON] = cache.weapon_icon;
 
 	ent->client->ps.stats[STAT_SPECTATOR] = 0;
 
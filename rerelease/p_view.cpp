@@ -1004,7 +1004,7 @@ void G_SetClientEvent(edict_t *ent)
 			current_client->last_ladder_sound < level.time &&
 			(current_client->last_ladder_pos - ent->s.origin).length() > 48.f)
 		{
-			ent->s.event = EV_LADDER_STEP;
+			G_SetEvent(ent, EV_LADDER_STEP);
 			current_client->last_ladder_pos = ent->s.origin;
 			current_client->last_ladder_sound = level.time + LADDER_SOUND_TIME;
 		}
@@ -1012,7 +1012,7 @@ void G_SetClientEvent(edict_t *ent)
 	else if (ent->groundentity && xyspeed > 225)
 	{
 		if ((int) (current_client->bobtime + bobmove) != bobcycle_run)
-			ent->s.event = EV_FOOTSTEP;
+			G_SetEvent(ent, EV_FOOTSTEP);
 	}
 }
 
@@ -1390,8 +1390,9 @@ void ClientEndServerFrame(edict_t *ent)
 		// if the scoreboard is up, update it if a client leaves
 		if (deathmatch->integer && ent->client->showscores && ent->client->menutime)
 		{
-			DeathmatchScoreboardMessage(ent, ent->enemy);
-			gi.unicast(ent, false);
+			// Sarah: only if it changed
+			if (DeathmatchScoreboardMessage(ent, ent->enemy, true))
+				gi.unicast(ent, false);
 			ent->client->menutime = 0_ms;
 		}
 
@@ -1494,8 +1495,8 @@ void ClientEndServerFrame(edict_t *ent)
 	{
 		if (ent->client->menu)
 		{
-			PMenu_Do_Update(ent);
-			gi.unicast(ent, true);
+			if (PMenu_Do_Update(ent, true))
+				gi.unicast(ent, true);
 		}
 		ent->client->menutime = level.time;
 		ent->client->menudirty = false;
@@ -1505,16 +1506,20 @@ void ClientEndServerFrame(edict_t *ent)
 	// if the scoreboard is up, update it
 	if (ent->client->showscores && ent->client->menutime <= level.time)
 	{
+		// Sarah: only sent if it changed, but it's still checked on the same schedule
+		bool changed;
+
 		// ZOID
 		if (ent->client->menu)
 		{
-			PMenu_Do_Update(ent);
+			changed = PMenu_Do_Update(ent, true);
 			ent->client->menudirty = false;
 		}
 		else
 			// ZOID
-			DeathmatchScoreboardMessage(ent, ent->enemy);
-		gi.unicast(ent, false);
+			changed = DeathmatchScoreboardMessage(ent, ent->enemy, true);
+		if (changed)
+			gi.unicast(ent, false);
 		ent->client->menutime = level.time + 3_sec;
 	}
 
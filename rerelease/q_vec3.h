@@ -7,6 +7,11 @@
 #include <stdexcept>
 #include <type_traits>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define Q_VEC3_SSE2
+#include <emmintrin.h>
+#endif
+
 using nullptr_t = std::nullptr_t;
 
 struct vec3_t
@@ -531,6 +536,59 @@ constexpr float STOP_EPSILON = 0.1f;
     return from * aFactor + to * bFactor;
 }
 
+// [Sarah] structure-of-arrays batch of vectors, for running the same test over a lot of
+// points at once. Gather the points in, then run the kernel below over them; the
+// SSE2 path does four at a time and gives the same results as the scalar one, which handles
+// the remainder (and everything, on targets without SSE2).
+template<size_t N>
+struct vec3_batch_t
+{
+	static_assert((N % 4) == 0, "batch size must be a multiple of 4");
+
+	alignas(16) float x[N];
+	alignas(16) float y[N];
+	alignas(16) float z[N];
+	size_t count = 0;
+
+	static constexpr size_t capacity = N;
+
+	constexpr void clear() { count = 0; }
+	[[nodiscard]] constexpr bool full() const { return count == N; }
+
+	constexpr void push(const vec3_t &v)
+	{
+		x[count] = v.x;
+		y[count] = v.y;
+		z[count] = v.z;
+		count++;
+	}
+};
+
+// out[i] = (point - v[i]).lengthSquared()
+template<size_t N>
+inline void vec3_batch_distance_squared(const vec3_batch_t<N> &v, const vec3_t &point, float *out)
+{
+	size_t i = 0;
+
+#ifdef Q_VEC3_SSE2
+	const __m128 px = _mm_set1_ps(point.x), py = _mm_set1_ps(point.y), pz = _mm_set1_ps(point.z);
+
+	for (; i + 4 <= v.count; i += 4)
+	{
+		__m128 dx = _mm_sub_ps(px, _mm_load_ps(v.x + i));
+		__m128 dy = _mm_sub_ps(py, _mm_load_ps(v.y + i));
+		__m128 dz = _mm_sub_ps(pz, _mm_load_ps(v.z + i));
+		_mm_storeu_ps(out + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+	}
+#endif
+
+	for (; i < v.count; i++)
+	{
+		float dx = point.x - v.x[i], dy = point.y - v.y[i], dz = point.z - v.z[i];
+		out[i] = dx * dx + dy * dy + dz * dz;
+	}
+}
+
 // Fmt support
 template<>
 struct fmt::formatter<vec3_t> : fmt::formatter<float>
@@ -34,91 +34,137 @@ inline item_flags_t GetSubstituteItemFlags(item_id_t id)
 	return flags;
 }
 
-inline item_id_t FindSubstituteItem(edict_t *ent)
+// Sarah: the substitution pools are worked out once, the first time they're needed, and
+// again only if one of the cvars that filters them changes. Each item maps to a pool; a
+// uniform pool is one irandom over its items and a weighted one is a single frandom checked
+// against its thresholds, which are the same draws the old code made, in the same order.
+static struct
 {
-	// never replace flags
-	if (ent->item->id == IT_FLAG1 || ent->item->id == IT_FLAG2 || ent->item->id == IT_ITEM_TAG_TOKEN)
-		return IT_NULL;
+	std::vector<random_respawn_pool_t> pools;
+	std::array<int16_t, IT_TOTAL> pool_of;
+	bool built;
+	int32_t no_spheres_modified, no_nukes_modified, no_mines_modified;
+} random_respawn;
 
-	// stimpack/shard randomizes
-	if (ent->item->id == IT_HEALTH_SMALL ||
-		ent->item->id == IT_ARMOR_SHARD)
-		return brandom() ? IT_HEALTH_SMALL : IT_ARMOR_SHARD;
+inline bool RandomRespawnCandidate(item_id_t i)
+{
+	const gitem_t *it = GetItemByIndex(i);
+	item_flags_t itflags = it->flags;
 
-	// health is special case
-	if (ent->item->id == IT_HEALTH_MEDIUM ||
-		ent->item->id == IT_HEALTH_LARGE)
-	{
-		float rnd = frandom();
+	if (!itflags || (itflags & (IF_NOT_GIVEABLE | IF_TECH | IF_NOT_RANDOM)) || !it->pickup || !it->world_model)
+		return false;
 
-		if (rnd < 0.6f)
-			return IT_HEALTH_MEDIUM;
-		else
-			return IT_HEALTH_LARGE;
-	}
-	// armor is also special case
-	else if (ent->item->id == IT_ARMOR_JACKET ||
-			 ent->item->id == IT_ARMOR_COMBAT ||
-			 ent->item->id == IT_ARMOR_BODY ||
-			 ent->item->id == IT_ITEM_POWER_SCREEN ||
-			 ent->item->id == IT_ITEM_POWER_SHIELD)
+	// don't respawn spheres if they're dmflag disabled.
+	if (g_no_spheres->integer)
 	{
-		float rnd = frandom();
-
-		if (rnd < 0.4f)
-			return IT_ARMOR_JACKET;
-		else if (rnd < 0.6f)
-			return IT_ARMOR_COMBAT;
-		else if (rnd < 0.8f)
-			return IT_ARMOR_BODY;
-		else if (rnd < 0.9f)
-			return IT_ITEM_POWER_SCREEN;
-		else
-			return IT_ITEM_POWER_SHIELD;
+		if (i == IT_ITEM_SPHERE_VENGEANCE ||
+			i == IT_ITEM_SPHERE_HUNTER ||
+			i == IT_ITEM_SPHERE_DEFENDER)
+		{
+			return false;
+		}
 	}
 
-	item_flags_t myflags = GetSubstituteItemFlags(ent->item->id);
+	if (g_no_nukes->integer && i == IT_AMMO_NUKE)
+		return false;
 
-	std::array<item_id_t, MAX_ITEMS> possible_items;
-	size_t possible_item_count = 0;
+	if (g_no_mines->integer &&
+		(i == IT_AMMO_PROX || i == IT_AMMO_TESLA || i == IT_AMMO_TRAP || i == IT_WEAPON_PROXLAUNCHER))
+		return false;
 
-	// gather matching items
-	for (item_id_t i = static_cast<item_id_t>(IT_NULL + 1); i < IT_TOTAL; i = static_cast<item_id_t>(static_cast<int32_t>(i) + 1))
-	{
-		const gitem_t *it = GetItemByIndex(i);
-		item_flags_t itflags = it->flags;
+	return true;
+}
 
-		if (!itflags || (itflags & (IF_NOT_GIVEABLE | IF_TECH | IF_NOT_RANDOM)) || !it->pickup || !it->world_model)
+static void BuildRandomRespawnPools()
+{
+	auto &pools = random_respawn.pools;
+
+	pools.clear();
+	random_respawn.pool_of.fill(-1);
+
+	auto add_pool = [&pools](random_respawn_pool_t pool, std::initializer_list<item_id_t> members) {
+		pools.push_back(std::move(pool));
+
+		for (item_id_t id : members)
+			random_respawn.pool_of[id] = (int16_t) (pools.size() - 1);
+	};
+
+	// flags never get replaced, so they have no pool
+
+	// stimpack/shard randomizes
+	add_pool({ random_respawn_pool_t::UNIFORM, { IT_HEALTH_SMALL, IT_ARMOR_SHARD } }, { IT_HEALTH_SMALL, IT_ARMOR_SHARD });
+
+	// health is special case
+	add_pool({ random_respawn_pool_t::WEIGHTED, { IT_HEALTH_MEDIUM, IT_HEALTH_LARGE }, { 0.6f, 1.0f } },
+		{ IT_HEALTH_MEDIUM, IT_HEALTH_LARGE });
+
+	// armor is also special case
+	add_pool({ random_respawn_pool_t::WEIGHTED,
+		{ IT_ARMOR_JACKET, IT_ARMOR_COMBAT, IT_ARMOR_BODY, IT_ITEM_POWER_SCREEN, IT_ITEM_POWER_SHIELD },
+		{ 0.4f, 0.6f, 0.8f, 0.9f, 1.0f } },
+		{ IT_ARMOR_JACKET, IT_ARMOR_COMBAT, IT_ARMOR_BODY, IT_ITEM_POWER_SCREEN, IT_ITEM_POWER_SHIELD });
+
+	// everything else picks evenly from the items in its class
+	std::unordered_map<uint32_t, int16_t> class_pools;
+
+	for (item_id_t id = static_cast<item_id_t>(IT_NULL + 1); id < IT_TOTAL; id = static_cast<item_id_t>(static_cast<int32_t>(id) + 1))
+	{
+		if (id == IT_FLAG1 || id == IT_FLAG2 || id == IT_ITEM_TAG_TOKEN || random_respawn.pool_of[id] != -1)
 			continue;
 
-		// don't respawn spheres if they're dmflag disabled.
-		if (g_no_spheres->integer)
+		item_flags_t myflags = GetSubstituteItemFlags(id) & IF_TYPE_MASK;
+		auto [it, inserted] = class_pools.try_emplace(static_cast<uint32_t>(myflags), static_cast<int16_t>(pools.size()));
+
+		if (inserted)
 		{
-			if (i == IT_ITEM_SPHERE_VENGEANCE ||
-				i == IT_ITEM_SPHERE_HUNTER ||
-				i == IT_ITEM_SPHERE_DEFENDER)
-			{
-				continue;
-			}
+			random_respawn_pool_t pool { random_respawn_pool_t::UNIFORM };
+
+			// gather matching items
+			for (item_id_t i = static_cast<item_id_t>(IT_NULL + 1); i < IT_TOTAL; i = static_cast<item_id_t>(static_cast<int32_t>(i) + 1))
+				if (RandomRespawnCandidate(i) && (GetSubstituteItemFlags(i) & IF_TYPE_MASK) == myflags)
+					pool.items.push_back(i);
+
+			pools.push_back(std::move(pool));
 		}
 
-		if (g_no_nukes->integer && i == IT_AMMO_NUKE)
-			continue;
+		random_respawn.pool_of[id] = it->second;
+	}
 
-		if (g_no_mines->integer &&
-			(i == IT_AMMO_PROX || i == IT_AMMO_TESLA || i == IT_AMMO_TRAP || i == IT_WEAPON_PROXLAUNCHER))
-			continue;
+	random_respawn.built = true;
+}
 
-		itflags = GetSubstituteItemFlags(i);
+const random_respawn_pool_t *GetRandomRespawnPool(item_id_t id)
+{
+	bool changed = Cvar_WasModified(g_no_spheres, random_respawn.no_spheres_modified);
+	changed |= Cvar_WasModified(g_no_nukes, random_respawn.no_nukes_modified);
+	changed |= Cvar_WasModified(g_no_mines, random_respawn.no_mines_modified);
 
-		if ((itflags & IF_TYPE_MASK) == (myflags & IF_TYPE_MASK))
-			possible_items[possible_item_count++] = i;
-	}
+	if (changed || !random_respawn.built)
+		BuildRandomRespawnPools();
+
+	if (id <= IT_NULL || id >= IT_TOTAL || random_respawn.pool_of[id] == -1)
+		return nullptr;
 
-	if (!possible_item_count)
+	return &random_respawn.pools[random_respawn.pool_of[id]];
+}
+
+inline item_id_t FindSubstituteItem(edict_t *ent)
+{
+	const random_respawn_pool_t *pool = GetRandomRespawnPool(ent->item->id);
+
+	if (!pool || pool->items.empty())
 		return IT_NULL;
 
-	return possible_items[irandom(possible_item_count)];
+	if (pool->kind == random_respawn_pool_t::UNIFORM)
+		return pool->items[irandom(pool->items.size())];
+
+	float rnd = frandom();
+
+	for (size_t i = 0; i < pool->items.size() - 1; i++)
+		if (rnd < pool->thresholds[i])
+			return pool->items[i];
+
+	return pool->items.back();
 }
 
 //=================
@@ -279,7 +325,7 @@ void fire_doppleganger(edict_t *ent, const vec3_t &start, const vec3_t &aimdir)
 	number = body->s.number;
 	body->s = ent->s;
 	body->s.sound = 0;
-	body->s.event = EV_NONE;
+	G_SetEvent(body, EV_NONE);
 	body->s.number = number;
 	body->yaw_speed = 30;
 	body->ideal_yaw = 0;
@@ -69,7 +69,7 @@ TOUCH(trigger_teleport_touch) (edict_t *self, edict_t *other, const trace_t &tr,
 		other->client->ps.pmove.pm_flags |= PMF_TIME_TELEPORT;
 
 		// draw the teleport splash at source and on the player
-		other->s.event = EV_PLAYER_TELEPORT;
+		G_SetEvent(other, EV_PLAYER_TELEPORT);
 
 		// set angles
 		other->client->ps.pmove.delta_angles = dest->s.angles - other->client->resp.cmd_angles;
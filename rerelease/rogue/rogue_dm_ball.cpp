@@ -475,7 +475,7 @@ THINK(DBall_BallRespawn) (edict_t *self) -> void
 
 	self->solid = SOLID_BBOX;
 	self->s.modelindex = gi.modelindex("models/objects/dball/tris.md2");
-	self->s.event = EV_PLAYER_TELEPORT;
+	G_SetEvent(self, EV_PLAYER_TELEPORT);
 	self->groundentity = nullptr;
 
 	gi.linkentity(self);
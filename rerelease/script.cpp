@@ -2,6 +2,12 @@
 
 #include "lua/lua.hpp"
 
+#include "json/json.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 // =============================================================================
 // Allocator for Lua memory
 // =============================================================================
@@ -10,6 +16,31 @@
 // Return values TagMalloc are not checked because it raises a fuss all by itself
 // if memory runs out
 
+// The allocator also keeps track of how much memory the Lua state is using, and enforces
+// the limit set by g_script_memory_limit (in kilobytes, 0 for no limit) by refusing to
+// allocate past it, so a runaway script gets a normal out of memory error instead of
+// taking the whole server down when TagMalloc fails. The limit is only enforced while a
+// script is running in protected mode, because an allocation failure anywhere else would
+// make Lua panic, which is exactly what the limit is there to prevent.
+
+struct script_memory_t
+{
+	// Bytes currently allocated
+	size_t live;
+	// Highest value of live since the current map's script was loaded
+	size_t peak;
+	// Number of blocks allocated and freed since the scripting engine started
+	size_t allocations;
+	size_t frees;
+	// Number of allocations refused because of the limit
+	size_t refused;
+};
+
+static struct script_memory_t script_memory;
+
+// Nonzero while a script is running in protected mode
+static int32_t script_protected;
+
 // The game engine doesn't provide a reallocator so we have to do it manually
 static void* script_realloc(void* ptr, size_t osize, size_t nsize)
 {
@@ -25,8 +56,17 @@ static void* script_realloc(void* ptr, size_t osize, size_t nsize)
 // Lua uses this for all its memory managements needs
 static void* script_lua_allocator(void* ud, void* ptr, size_t osize, size_t nsize)
 {
+	// When ptr is null, osize is a type tag instead of a size
+	size_t old_size = (ptr != nullptr) ? osize : 0;
+
 	if (nsize == 0)
 	{
+		if (ptr != nullptr)
+		{
+			script_memory.live -= old_size;
+			script_memory.frees++;
+		}
+
 		gi.TagFree(ptr);
 
 		// Lua expects null as the result of free
@@ -34,8 +74,24 @@ static void* script_lua_allocator(void* ud, void* ptr, size_t osize, size_t nsiz
 	}
 	else
 	{
+		// Refusing to grow makes Lua run a full garbage collection and try again before raising an error
+		if (nsize > old_size && script_protected && g_script_memory_limit->integer > 0 &&
+			script_memory.live - old_size + nsize > (size_t)g_script_memory_limit->integer * 1024)
+		{
+			script_memory.refused++;
+			return nullptr;
+		}
+
+		script_memory.live = script_memory.live - old_size + nsize;
+
+		if (script_memory.live > script_memory.peak)
+		{
+			script_memory.peak = script_memory.live;
+		}
+
 		if (ptr == nullptr)
 		{
+			script_memory.allocations++;
 			return gi.TagMalloc(nsize, TAG_GAME);
 		}
 		else
@@ -138,6 +194,24 @@ static vec3_t* script_check_vector(lua_State* L, int arg)
 	return (vec3_t*)luaL_checkudata(L, arg, "script_vector");
 }
 
+// Functions that create a vector can take an optional output vector as their last argument,
+// in which case the result is written into it and it's returned instead of a new vector
+// This lets scripts doing vector math every frame avoid creating garbage
+static void script_return_vector(lua_State* L, vec3_t& result, int out_arg)
+{
+	vec3_t* out = luaL_opt(L, script_check_vector, out_arg, nullptr);
+
+	if (out != nullptr)
+	{
+		*out = result;
+		lua_pushvalue(L, out_arg);
+	}
+	else
+	{
+		script_push_vector(L, result);
+	}
+}
+
 // Add vectors
 static int script_vector_add(lua_State* L)
 {
@@ -241,7 +315,7 @@ static int script_vector_direction(lua_State* L)
 		result = vectoangles(result);
 	}
 
-	script_push_vector(L, result);
+	script_return_vector(L, result, 4);
 
 	return 1;
 }
@@ -268,11 +342,223 @@ static int script_vector_lerp(lua_State* L)
 
 	vec3_t result = *vec1 + (*vec2 - *vec1) * fraction;
 
-	script_push_vector(L, result);
+	script_return_vector(L, result, 4);
+
+	return 1;
+}
+
+// Add another vector to this one, with an optional output vector
+static int script_vector_plus(lua_State* L)
+{
+	vec3_t* vec1 = script_check_vector(L, 1);
+	vec3_t* vec2 = script_check_vector(L, 2);
+
+	vec3_t result = *vec1 + *vec2;
+
+	script_return_vector(L, result, 3);
+
+	return 1;
+}
+
+// Subtract another vector from this one, with an optional output vector
+static int script_vector_minus(lua_State* L)
+{
+	vec3_t* vec1 = script_check_vector(L, 1);
+	vec3_t* vec2 = script_check_vector(L, 2);
+
+	vec3_t result = *vec1 - *vec2;
+
+	script_return_vector(L, result, 3);
+
+	return 1;
+}
+
+// Multiply this vector by a scalar, with an optional output vector
+static int script_vector_scale(lua_State* L)
+{
+	vec3_t* vec = script_check_vector(L, 1);
+	float number = luaL_checknumber(L, 2);
+
+	vec3_t result = *vec * number;
+
+	script_return_vector(L, result, 3);
+
+	return 1;
+}
+
+// Dot product of two vectors
+static int script_vector_dot(lua_State* L)
+{
+	vec3_t* vec1 = script_check_vector(L, 1);
+	vec3_t* vec2 = script_check_vector(L, 2);
+
+	lua_pushnumber(L, vec1->dot(*vec2));
+
+	return 1;
+}
+
+// Length of a vector
+static int script_vector_length(lua_State* L)
+{
+	vec3_t* vec = script_check_vector(L, 1);
+
+	lua_pushnumber(L, vec->length());
+
+	return 1;
+}
+
+// In-place versions of the above, which modify the vector itself and return it
+// Vectors obtained from entities are copies, so this can't change an entity by accident
+
+// Set the components of the vector
+static int script_vector_set_inplace(lua_State* L)
+{
+	vec3_t* vec = script_check_vector(L, 1);
+
+	vec->x = luaL_checknumber(L, 2);
+	vec->y = luaL_checknumber(L, 3);
+	vec->z = luaL_checknumber(L, 4);
+
+	lua_settop(L, 1);
+
+	return 1;
+}
+
+// Copy another vector into this one
+static int script_vector_copy_inplace(lua_State* L)
+{
+	vec3_t* vec1 = script_check_vector(L, 1);
+	vec3_t* vec2 = script_check_vector(L, 2);
+
+	*vec1 = *vec2;
+
+	lua_settop(L, 1);
+
+	return 1;
+}
+
+// Add another vector to this one, optionally scaled first
+static int script_vector_add_inplace(lua_State* L)
+{
+	vec3_t* vec1 = script_check_vector(L, 1);
+	vec3_t* vec2 = script_check_vector(L, 2);
+	float scale = luaL_optnumber(L, 3, 1);
+
+	*vec1 += *vec2 * scale;
+
+	lua_settop(L, 1);
+
+	return 1;
+}
+
+// Subtract another vector from this one
+static int script_vector_sub_inplace(lua_State* L)
+{
+	vec3_t* vec1 = script_check_vector(L, 1);
+	vec3_t* vec2 = script_check_vector(L, 2);
+
+	*vec1 -= *vec2;
+
+	lua_settop(L, 1);
+
+	return 1;
+}
+
+// Multiply this vector by a scalar
+static int script_vector_scale_inplace(lua_State* L)
+{
+	vec3_t* vec = script_check_vector(L, 1);
+	float number = luaL_checknumber(L, 2);
+
+	*vec *= number;
+
+	lua_settop(L, 1);
+
+	return 1;
+}
+
+// Normalize this vector
+static int script_vector_normalize_inplace(lua_State* L)
+{
+	vec3_t* vec = script_check_vector(L, 1);
+
+	*vec = vec->normalized();
+
+	lua_settop(L, 1);
+
+	return 1;
+}
+
+// __index metamethod for vectors
+// Components are looked up directly by name, and anything else goes to the member function table
+// in the first upvalue; since this is only ever called as a metamethod, the first argument is
+// guaranteed to be a vector
+static int script_vector_index(lua_State* L)
+{
+	vec3_t* vec = (vec3_t*)lua_touserdata(L, 1);
+
+	if (lua_type(L, 2) == LUA_TSTRING)
+	{
+		size_t len;
+		const char* key = lua_tolstring(L, 2, &len);
+
+		if (len == 1)
+		{
+			switch (key[0])
+			{
+			case 'x':
+				lua_pushnumber(L, vec->x);
+				return 1;
+
+			case 'y':
+				lua_pushnumber(L, vec->y);
+				return 1;
+
+			case 'z':
+				lua_pushnumber(L, vec->z);
+				return 1;
+			}
+		}
+	}
+
+	lua_pushvalue(L, 2);
+	lua_rawget(L, lua_upvalueindex(1));
 
 	return 1;
 }
 
+// __newindex metamethod for vectors, which only allows the components to be set
+static int script_vector_newindex(lua_State* L)
+{
+	vec3_t* vec = (vec3_t*)lua_touserdata(L, 1);
+
+	if (lua_type(L, 2) == LUA_TSTRING)
+	{
+		size_t len;
+		const char* key = lua_tolstring(L, 2, &len);
+
+		if (len == 1)
+		{
+			switch (key[0])
+			{
+			case 'x':
+				vec->x = luaL_checknumber(L, 3);
+				return 0;
+
+			case 'y':
+				vec->y = luaL_checknumber(L, 3);
+				return 0;
+
+			case 'z':
+				vec->z = luaL_checknumber(L, 3);
+				return 0;
+			}
+		}
+	}
+
+	return luaL_error(L, "attempt to set a vector field other than x, y, or z");
+}
+
 // =============================================================================
 // Entity functions
 // =============================================================================
@@ -996,20 +1282,86 @@ static void script_push_entity(lua_State* L, edict_t* ent)
 }
 
 // =============================================================================
-// API functions
+// Spawn template functions
 // =============================================================================
 
-// Spawn a new entity
-static int script_spawn(lua_State* L)
+// A template holds the properties for spawning an entity with every key already looked
+// up and every value already converted, so scripts that spawn the same kind of entity over
+// and over again (like waves of monsters) don't have to pay for parsing the properties table
+// every time. Spawning from a template gives exactly the same result as spawn would with the
+// same properties table.
+
+// Prepared values can include strings allocated as TAG_LEVEL, so a template remembers which
+// script load it was prepared for. The original keys and values are kept as strings in the
+// template's user value so it can prepare them again if it outlives the level it was made on.
+
+// Incremented every time a script is loaded
+static int32_t script_load_count;
+
+// Userdata structure for template; the prepared fields follow immediately after it
+struct script_ud_template_t
 {
-	luaL_checktype(L, 1, LUA_TTABLE);
-	vec3_t* origin = luaL_opt(L, script_check_vector, 2, nullptr);
-	vec3_t* angles = luaL_opt(L, script_check_vector, 3, nullptr);
+	int32_t load_count;
+	int32_t num_strings;
+	int32_t num_fields;
+};
 
-	// Spawn the entity
+static prepared_field_t* script_template_fields(struct script_ud_template_t* ud)
+{
+	return (prepared_field_t*)(ud + 1);
+}
+
+// Prepare the fields of the template at the given index from the strings in its user value
+static void script_template_prepare(lua_State* L, int idx, struct script_ud_template_t* ud)
+{
+	prepared_field_t* fields = script_template_fields(ud);
+
+	ud->num_fields = 0;
+
+	lua_getiuservalue(L, idx, 1);
+
+	for (int i = 1; i < ud->num_strings; i += 2)
+	{
+		lua_rawgeti(L, -1, i);
+		lua_rawgeti(L, -2, i + 1);
+
+		// Strings in the user value table stay alive as long as the template does
+		const char* key = lua_tostring(L, -2);
+		const char* value = lua_tostring(L, -1);
+
+		// Invalid keys are reported once here and then left out
+		if (ED_PrepareField(key, value, fields[ud->num_fields]))
+		{
+			ud->num_fields++;
+		}
+
+		lua_pop(L, 2);
+	}
+
+	lua_pop(L, 1);
+
+	ud->load_count = script_load_count;
+}
+
+// Check if an argument is a template, and return a pointer to it after making sure it's ready to use
+static struct script_ud_template_t* script_check_template(lua_State* L, int arg)
+{
+	struct script_ud_template_t* ud = (struct script_ud_template_t*)luaL_checkudata(L, arg, "script_template");
+
+	if (ud->load_count != script_load_count)
+	{
+		script_template_prepare(L, arg, ud);
+	}
+
+	return ud;
+}
+
+// Spawn an entity from a template, returning it if it still exists afterward
+// Goes through the same steps as spawn in the same order
+static edict_t* script_template_spawn_entity(struct script_ud_template_t* ud, const vec3_t* origin, const vec3_t* angles)
+{
 	edict_t* ent = G_Spawn();
 
-	// Set origin and angles if they were provided
 	if (origin != nullptr)
 	{
 		ent->s.origin = *origin;
@@ -1020,41 +1372,33 @@ static int script_spawn(lua_State* L)
 		ent->s.angles = *angles;
 	}
 
-	// Read-only tables are empty proxies, so instead operate on the table for the __index metamethod if one exists
-	int type = luaL_getmetafield(L, 1, "__index");
-
-	int idx = 1;
+	prepared_field_t* fields = script_template_fields(ud);
 
-	if (type != LUA_TNIL)
+	for (int i = 0; i < ud->num_fields; i++)
 	{
-		if (type == LUA_TTABLE)
-		{
-			idx = -2;
-		}
-		else
-		{
-			lua_pop(L, 1);
-		}
+		ED_ApplyPreparedField(fields[i], ent);
 	}
 
-	// Iterate through the properties table
-	lua_pushnil(L);
+	ED_CallSpawn(ent);
 
-	while (lua_next(L, idx) != 0)
+	if (!ent->inuse)
 	{
-		const char* key = luaL_tolstring(L, -2, nullptr);
-		const char* value = luaL_tolstring(L, -2, nullptr);
+		return nullptr;
+	}
 
-		ED_ParseField(key, value, ent);
+	return ent;
+}
 
-		lua_pop(L, 3);
-	}
+// Spawn a single entity from the template, with optional origin and angles like spawn
+static int script_template_spawn(lua_State* L)
+{
+	struct script_ud_template_t* ud = script_check_template(L, 1);
+	vec3_t* origin = luaL_opt(L, script_check_vector, 2, nullptr);
+	vec3_t* angles = luaL_opt(L, script_check_vector, 3, nullptr);
 
-	// Call the spawn function for the entity
-	ED_CallSpawn(ent);
+	edict_t* ent = script_template_spawn_entity(ud, origin, angles);
 
-	// If the entity still exists, return it; otherwise, return nil
-	if (ent->inuse)
+	if (ent != nullptr)
 	{
 		script_push_entity(L, ent);
 	}
@@ -1066,43 +1410,211 @@ static int script_spawn(lua_State* L)
 	return 1;
 }
 
-// Create a new vector
-static int script_vector(lua_State* L)
+// Spawn one entity from the template for each origin in a list
+// Angles can be a single vector used for all of them or a list matching the origins
+// Returns a list of the entities that still exist after spawning and their count, like filter
+static int script_template_spawnmany(lua_State* L)
 {
-	vec3_t vec = {};
-
-	vec.x = luaL_checknumber(L, 1);
-	vec.y = luaL_checknumber(L, 2);
-	vec.z = luaL_checknumber(L, 3);
-
-	script_push_vector(L, vec);
+	struct script_ud_template_t* ud = script_check_template(L, 1);
+	luaL_checktype(L, 2, LUA_TTABLE);
 
-	return 1;
-}
+	bool angles_list = lua_type(L, 3) == LUA_TTABLE;
+	vec3_t* angles = nullptr;
 
-// This is equivalent to the old G_Find except it skips worldspawn, the players, and the body queue
-static edict_t* script_find_offset(edict_t* from, size_t value_offset, const char* value)
-{
-	// If from is null, start from the beginning
-	if (from == nullptr)
+	if (!angles_list)
 	{
-		// Skip worldspawn, the players, and the body queue
-		// This points to the last body queue slot but it late gets preincremented by the loop
-		from = g_edicts + game.maxclients + BODY_QUEUE_SIZE;
+		angles = luaL_opt(L, script_check_vector, 3, nullptr);
 	}
 
-	while (++from < &g_edicts[globals.num_edicts])
+	lua_settop(L, 3);
+
+	int n = luaL_len(L, 2);
+	int count = 0;
+
+	lua_createtable(L, n, 0);
+
+	for (int i = 1; i <= n; i++)
 	{
-		if (!from->inuse)
+		lua_geti(L, 2, i);
+		vec3_t* origin = script_check_vector(L, -1);
+
+		if (angles_list)
 		{
-			continue;
+			lua_geti(L, 3, i);
+			angles = luaL_opt(L, script_check_vector, -1, nullptr);
 		}
 
-		const char* str = *(const char**)((const char*)from + value_offset);
+		edict_t* ent = script_template_spawn_entity(ud, origin, angles);
 
-		if (str == nullptr)
+		// Origin and angles vectors are still referenced by their lists so this is safe after use
+		lua_settop(L, 4);
+
+		if (ent != nullptr)
 		{
-			continue;
+			script_push_entity(L, ent);
+			lua_rawseti(L, 4, ++count);
+		}
+	}
+
+	lua_pushinteger(L, count);
+
+	return 2;
+}
+
+// =============================================================================
+// API functions
+// =============================================================================
+
+// Read-only tables are empty proxies, so get the absolute index of the table for the __index
+// metamethod if one exists, pushing it onto the stack; otherwise, the table itself is used
+static int script_properties_index(lua_State* L, int arg)
+{
+	int type = luaL_getmetafield(L, arg, "__index");
+
+	if (type == LUA_TTABLE)
+	{
+		return lua_gettop(L);
+	}
+
+	if (type != LUA_TNIL)
+	{
+		lua_pop(L, 1);
+	}
+
+	return arg;
+}
+
+// Spawn a new entity
+static int script_spawn(lua_State* L)
+{
+	luaL_checktype(L, 1, LUA_TTABLE);
+	vec3_t* origin = luaL_opt(L, script_check_vector, 2, nullptr);
+	vec3_t* angles = luaL_opt(L, script_check_vector, 3, nullptr);
+
+	// Spawn the entity
+	edict_t* ent = G_Spawn();
+
+	// Set origin and angles if they were provided
+	if (origin != nullptr)
+	{
+		ent->s.origin = *origin;
+	}
+
+	if (angles != nullptr)
+	{
+		ent->s.angles = *angles;
+	}
+
+	int idx = script_properties_index(L, 1);
+
+	// Iterate through the properties table
+	lua_pushnil(L);
+
+	while (lua_next(L, idx) != 0)
+	{
+		const char* key = luaL_tolstring(L, -2, nullptr);
+		const char* value = luaL_tolstring(L, -2, nullptr);
+
+		ED_ParseField(key, value, ent);
+
+		lua_pop(L, 3);
+	}
+
+	// Call the spawn function for the entity
+	ED_CallSpawn(ent);
+
+	// If the entity still exists, return it; otherwise, return nil
+	if (ent->inuse)
+	{
+		script_push_entity(L, ent);
+	}
+	else
+	{
+		lua_pushnil(L);
+	}
+
+	return 1;
+}
+
+// Create a spawn template from a properties table
+static int script_template(lua_State* L)
+{
+	luaL_checktype(L, 1, LUA_TTABLE);
+	lua_settop(L, 1);
+
+	int idx = script_properties_index(L, 1);
+
+	// Copy the keys and values as strings in the same order spawn would use them
+	lua_newtable(L);
+	int strings = lua_gettop(L);
+
+	int n = 0;
+
+	lua_pushnil(L);
+
+	while (lua_next(L, idx) != 0)
+	{
+		luaL_tolstring(L, -2, nullptr);
+		lua_rawseti(L, strings, ++n);
+		luaL_tolstring(L, -1, nullptr);
+		lua_rawseti(L, strings, ++n);
+
+		lua_pop(L, 1);
+	}
+
+	// Create the template with room for every field and prepare it
+	struct script_ud_template_t* ud = (struct script_ud_template_t*)lua_newuserdatauv(L, sizeof(struct script_ud_template_t) + (n / 2) * sizeof(prepared_field_t), 1);
+
+	ud->num_strings = n;
+	ud->num_fields = 0;
+
+	lua_rotate(L, -2, 1);
+	lua_setiuservalue(L, -2, 1);
+
+	luaL_setmetatable(L, "script_template");
+
+	script_template_prepare(L, -1, ud);
+
+	return 1;
+}
+
+// Create a new vector
+static int script_vector(lua_State* L)
+{
+	vec3_t vec = {};
+
+	vec.x = luaL_checknumber(L, 1);
+	vec.y = luaL_checknumber(L, 2);
+	vec.z = luaL_checknumber(L, 3);
+
+	script_push_vector(L, vec);
+
+	return 1;
+}
+
+// This is equivalent to the old G_Find except it skips worldspawn, the players, and the body queue
+static edict_t* script_find_offset(edict_t* from, size_t value_offset, const char* value)
+{
+	// If from is null, start from the beginning
+	if (from == nullptr)
+	{
+		// Skip worldspawn, the players, and the body queue
+		// This points to the last body queue slot but it late gets preincremented by the loop
+		from = g_edicts + game.maxclients + BODY_QUEUE_SIZE;
+	}
+
+	while (++from < &g_edicts[globals.num_edicts])
+	{
+		if (!from->inuse)
+		{
+			continue;
+		}
+
+		const char* str = *(const char**)((const char*)from + value_offset);
+
+		if (str == nullptr)
+		{
+			continue;
 		}
 
 		if (Q_strcasecmp(str, value) == 0)
@@ -1114,70 +1626,80 @@ static edict_t* script_find_offset(edict_t* from, size_t value_offset, const cha
 	return nullptr;
 }
 
-// Returns a list of all entities with a given value for a string key (defaulting to targetname)
-static int script_find(lua_State* L)
+// Get the offset in edict_t for a string key, returning false if the key isn't a string
+static bool script_string_key_offset(int key, size_t* value_offset)
 {
-	const char* value = luaL_checkstring(L, 1);
-	int key = luaL_checkoption(L, 2, "targetname", script_entity_keys);
-
-	// Get the offset for the given key which is used to identify it by the search function
-	size_t value_offset;
-
 	switch (key)
 	{
 	case ENTITY_KEY_CLASSNAME:
-		value_offset = offsetof(edict_t, classname);
-		break;
+		*value_offset = offsetof(edict_t, classname);
+		return true;
 
 	case ENTITY_KEY_TEAM:
-		value_offset = offsetof(edict_t, team);
-		break;
+		*value_offset = offsetof(edict_t, team);
+		return true;
 
 	case ENTITY_KEY_TARGETNAME:
-		value_offset = offsetof(edict_t, targetname);
-		break;
+		*value_offset = offsetof(edict_t, targetname);
+		return true;
 
 	case ENTITY_KEY_TARGET:
-		value_offset = offsetof(edict_t, target);
-		break;
+		*value_offset = offsetof(edict_t, target);
+		return true;
 
 	case ENTITY_KEY_KILLTARGET:
-		value_offset = offsetof(edict_t, killtarget);
-		break;
+		*value_offset = offsetof(edict_t, killtarget);
+		return true;
 
 	case ENTITY_KEY_PATHTARGET:
-		value_offset = offsetof(edict_t, pathtarget);
-		break;
+		*value_offset = offsetof(edict_t, pathtarget);
+		return true;
 
 	case ENTITY_KEY_DEATHTARGET:
-		value_offset = offsetof(edict_t, deathtarget);
-		break;
+		*value_offset = offsetof(edict_t, deathtarget);
+		return true;
 
 	case ENTITY_KEY_HEALTHTARGET:
-		value_offset = offsetof(edict_t, healthtarget);
-		break;
+		*value_offset = offsetof(edict_t, healthtarget);
+		return true;
 
 	case ENTITY_KEY_ITEMTARGET:
-		value_offset = offsetof(edict_t, itemtarget);
-		break;
+		*value_offset = offsetof(edict_t, itemtarget);
+		return true;
 
 	case ENTITY_KEY_COMBATTARGET:
-		value_offset = offsetof(edict_t, combattarget);
-		break;
+		*value_offset = offsetof(edict_t, combattarget);
+		return true;
 
 	case ENTITY_KEY_SCRIPT_FUNCTION:
-		value_offset = offsetof(edict_t, script_function);
-		break;
+		*value_offset = offsetof(edict_t, script_function);
+		return true;
 
 	case ENTITY_KEY_SCRIPT_ARG:
-		value_offset = offsetof(edict_t, script_arg);
-		break;
+		*value_offset = offsetof(edict_t, script_arg);
+		return true;
 
 	case ENTITY_KEY_MESSAGE:
-		value_offset = offsetof(edict_t, message);
-		break;
+		*value_offset = offsetof(edict_t, message);
+		return true;
 
 	default:
+		return false;
+	}
+
+}
+
+// Returns a list of all entities with a given value for a string key (defaulting to targetname)
+static int script_find(lua_State* L)
+{
+	const char* value = luaL_checkstring(L, 1);
+	int key = luaL_checkoption(L, 2, "targetname", script_entity_keys);
+
+	// Get the offset for the given key which is used to identify it by the search function
+	size_t value_offset;
+
+	if (!script_string_key_offset(key, &value_offset))
+	{
 		return luaL_argerror(L, 2, "attempt to search by non-string key");
 	}
 
@@ -1197,119 +1719,580 @@ static int script_find(lua_State* L)
 	return 1;
 }
 
-// For each element in a list, calls a function with that element as the argument
-static int script_foreach(lua_State* L)
+// For each element in a list, calls a function with that element as the argument
+static int script_foreach(lua_State* L)
+{
+	luaL_checktype(L, 1, LUA_TTABLE);
+	luaL_checktype(L, 2, LUA_TFUNCTION);
+
+	lua_len(L, 1);
+	int n = lua_tointeger(L, -1);
+
+	for (int i = 1; i <= n; i++)
+	{
+		lua_pushvalue(L, 2);
+		lua_geti(L, 1, i);
+		lua_call(L, 1, 0);
+	}
+
+	return 0;
+}
+
+// Same as foreach, but returns a list containing every element for which the function returned anything but nil or false
+// Also returns an integer containing the count as a second return value
+static int script_filter(lua_State* L)
+{
+	luaL_checktype(L, 1, LUA_TTABLE);
+	luaL_checktype(L, 2, LUA_TFUNCTION);
+
+	lua_len(L, 1);
+	int n = lua_tointeger(L, -1);
+
+	int count = 0;
+
+	lua_newtable(L);
+
+	for (int i = 1; i <= n; i++)
+	{
+		lua_pushvalue(L, 2);
+		lua_geti(L, 1, i);
+		lua_call(L, 1, 1);
+
+		int keep = lua_toboolean(L, -1);
+		lua_pop(L, 1);
+
+		if (keep)
+		{
+			lua_rawgeti(L, 1, i);
+			lua_rawseti(L, -2, ++count);
+		}
+	}
+
+	lua_pushinteger(L, count);
+
+	return 2;
+}
+
+// Returns a randomly-selected element from the list
+static int script_pick(lua_State* L)
+{
+	luaL_checktype(L, 1, LUA_TTABLE);
+
+	lua_len(L, 1);
+	int n = lua_tointeger(L, -1);
+
+	if (n == 0)
+	{
+		lua_pushnil(L);
+	}
+	else
+	{
+		lua_geti(L, 1, 1 + irandom(n));
+	}
+
+	return 1;
+}
+
+// Iterator function equivalent to the values iterator from Programming in Lua
+static int script_values_iterator(lua_State* L)
+{
+	// Increment the index
+	lua_pushvalue(L, lua_upvalueindex(2));
+	lua_pushinteger(L, 1);
+	lua_arith(L, LUA_OPADD);
+
+	// Get the value of the index and overwrite the old upvalue
+	int i = lua_tointeger(L, -1);
+	lua_replace(L, lua_upvalueindex(2));
+
+	// Return the element at that index
+	lua_geti(L, lua_upvalueindex(1), i);
+
+	return 1;
+}
+
+// Factory for the values iterator
+static int script_values(lua_State* L)
+{
+	// Argument must be a table and is the iterator's first upvalue
+	luaL_checktype(L, 1, LUA_TTABLE);
+
+	// Pop excess arguments
+	int n = lua_gettop(L);
+
+	if (n > 1)
+	{
+		lua_pop(L, n - 1);
+	}
+
+	// An index is the iterator's second upvalue
+	lua_pushinteger(L, 0);
+
+	// Push the function as the return value
+	lua_pushcclosure(L, script_values_iterator, 2);
+
+	return 1;
+}
+
+// =============================================================================
+// Entity iterators
+// =============================================================================
+
+// These are iterators for generic for loops that walk the entity array as the loop runs,
+// instead of collecting every match into a table first, so stopping early costs nothing
+// The optional filter table can contain any string key that find accepts, minhealth and
+// maxhealth, and the booleans monster, player, dead, and takedamage, and every entity has
+// to match all of them. All of the checks are done in C before an entity is returned.
+
+// Unlike find, players are included so they can be iterated with player = true
+
+// Flags that can be required or forbidden by a filter
+enum script_filter_flags
+{
+	FILTER_MONSTER = 1 << 0,
+	FILTER_PLAYER = 1 << 1,
+	FILTER_DEAD = 1 << 2,
+	FILTER_TAKEDAMAGE = 1 << 3
+};
+
+static const char* script_filter_flag_keys[] =
+{
+	"monster",
+	"player",
+	"dead",
+	"takedamage",
+	nullptr
+};
+
+// Maximum number of string keys in a filter
+static const int32_t script_filter_strings_max = 8;
+
+// Userdata structure for iterator state
+struct script_ud_iterator_t
+{
+	// Next entity to check
+	uint32_t index;
+
+	// String keys as offsets into edict_t and the values they must have
+	int32_t num_strings;
+	size_t string_offsets[script_filter_strings_max];
+	const char* string_values[script_filter_strings_max];
+
+	uint32_t flags_required;
+	uint32_t flags_forbidden;
+
+	bool check_min_health;
+	bool check_max_health;
+	int32_t min_health;
+	int32_t max_health;
+
+	bool check_radius;
+	vec3_t origin;
+	float radius;
+};
+
+// Read a filter table into the iterator state at the top of the stack
+// The string values are copied into the state's user value so they stay valid for as long as the iterator does
+static void script_iterator_filter(lua_State* L, int arg, struct script_ud_iterator_t* it)
+{
+	if (lua_isnoneornil(L, arg))
+	{
+		return;
+	}
+
+	luaL_checktype(L, arg, LUA_TTABLE);
+
+	lua_newtable(L);
+	int strings = lua_gettop(L);
+
+	lua_pushnil(L);
+
+	while (lua_next(L, arg) != 0)
+	{
+		if (lua_type(L, -2) != LUA_TSTRING)
+		{
+			luaL_error(L, "invalid key for filter: must be string");
+		}
+
+		const char* key = lua_tostring(L, -2);
+
+		if (!strcmp(key, "minhealth"))
+		{
+			it->check_min_health = true;
+			it->min_health = luaL_checkinteger(L, -1);
+		}
+		else if (!strcmp(key, "maxhealth"))
+		{
+			it->check_max_health = true;
+			it->max_health = luaL_checkinteger(L, -1);
+		}
+		else
+		{
+			int i;
+
+			// Check for a flag
+			for (i = 0; script_filter_flag_keys[i]; i++)
+			{
+				if (!strcmp(key, script_filter_flag_keys[i]))
+				{
+					break;
+				}
+			}
+
+			if (script_filter_flag_keys[i])
+			{
+				if (lua_toboolean(L, -1))
+				{
+					it->flags_required |= 1 << i;
+				}
+				else
+				{
+					it->flags_forbidden |= 1 << i;
+				}
+			}
+			else
+			{
+				// Check for a string key
+				for (i = 0; script_entity_keys[i]; i++)
+				{
+					if (!strcmp(key, script_entity_keys[i]))
+					{
+						break;
+					}
+				}
+
+				size_t value_offset;
+
+				if (!script_entity_keys[i] || !script_string_key_offset(i, &value_offset))
+				{
+					luaL_error(L, "invalid key for filter: %s", key);
+				}
+
+				if (lua_type(L, -1) != LUA_TSTRING)
+				{
+					luaL_error(L, "invalid value for filter key %s: must be string", key);
+				}
+
+				if (it->num_strings >= script_filter_strings_max)
+				{
+					luaL_error(L, "too many string keys in filter");
+				}
+
+				lua_pushvalue(L, -1);
+				lua_rawseti(L, strings, it->num_strings + 1);
+
+				it->string_offsets[it->num_strings] = value_offset;
+				it->string_values[it->num_strings] = lua_tostring(L, -1);
+				it->num_strings++;
+			}
+		}
+
+		lua_pop(L, 1);
+	}
+
+	lua_setiuservalue(L, -2, 1);
+}
+
+// Check an entity against the iterator's filter
+static bool script_iterator_matches(const struct script_ud_iterator_t* it, edict_t* ent)
+{
+	if (!ent->inuse)
+	{
+		return false;
+	}
+
+	if (it->flags_required || it->flags_forbidden)
+	{
+		uint32_t flags = 0;
+
+		if (ent->svflags & SVF_MONSTER)
+		{
+			flags |= FILTER_MONSTER;
+		}
+
+		if (ent->svflags & SVF_PLAYER)
+		{
+			flags |= FILTER_PLAYER;
+		}
+
+		if (ent->deadflag)
+		{
+			flags |= FILTER_DEAD;
+		}
+
+		if (ent->takedamage)
+		{
+			flags |= FILTER_TAKEDAMAGE;
+		}
+
+		if ((flags & it->flags_required) != it->flags_required || (flags & it->flags_forbidden))
+		{
+			return false;
+		}
+	}
+
+	if (it->check_min_health && ent->health < it->min_health)
+	{
+		return false;
+	}
+
+	if (it->check_max_health && ent->health > it->max_health)
+	{
+		return false;
+	}
+
+	for (int i = 0; i < it->num_strings; i++)
+	{
+		const char* str = *(const char**)((const char*)ent + it->string_offsets[i]);
+
+		if (str == nullptr || Q_strcasecmp(str, it->string_values[i]))
+		{
+			return false;
+		}
+	}
+
+	// Same test as findradius, measured to the center of the entity's bounds
+	if (it->check_radius)
+	{
+		vec3_t eorg = it->origin - (ent->s.origin + (ent->mins + ent->maxs) * 0.5f);
+
+		if (eorg.lengthSquared() > it->radius * it->radius)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Iterator function, with the state as its only upvalue
+static int script_iterator_next(lua_State* L)
+{
+	struct script_ud_iterator_t* it = (struct script_ud_iterator_t*)lua_touserdata(L, lua_upvalueindex(1));
+
+	while (it->index < globals.num_edicts)
+	{
+		edict_t* ent = &g_edicts[it->index++];
+
+		// Skip the body queue
+		if (it->index == game.maxclients + 1)
+		{
+			it->index += BODY_QUEUE_SIZE;
+		}
+
+		if (script_iterator_matches(it, ent))
+		{
+			script_push_entity(L, ent);
+			return 1;
+		}
+	}
+
+	lua_pushnil(L);
+
+	return 1;
+}
+
+// Create the iterator state at the top of the stack, starting after worldspawn
+// The stack is trimmed to the function's arguments first, so a missing filter is seen as none
+// rather than as the iterator state that would otherwise end up in its slot
+static struct script_ud_iterator_t* script_iterator_new(lua_State* L, int nargs)
+{
+	lua_settop(L, nargs);
+
+	struct script_ud_iterator_t* it = (struct script_ud_iterator_t*)lua_newuserdatauv(L, sizeof(struct script_ud_iterator_t), 1);
+
+	*it = {};
+	it->index = 1;
+
+	return it;
+}
+
+// Iterate over all entities matching an optional filter
+static int script_each(lua_State* L)
+{
+	struct script_ud_iterator_t* it = script_iterator_new(L, 1);
+	script_iterator_filter(L, 1, it);
+
+	lua_pushcclosure(L, script_iterator_next, 1);
+
+	return 1;
+}
+
+// Iterate over all entities within a radius of a point, matching an optional filter
+static int script_near(lua_State* L)
 {
-	luaL_checktype(L, 1, LUA_TTABLE);
-	luaL_checktype(L, 2, LUA_TFUNCTION);
+	vec3_t* origin = script_check_vector(L, 1);
+	float radius = luaL_checknumber(L, 2);
 
-	lua_len(L, 1);
-	int n = lua_tointeger(L, -1);
+	struct script_ud_iterator_t* it = script_iterator_new(L, 3);
+	it->check_radius = true;
+	it->origin = *origin;
+	it->radius = radius;
+	script_iterator_filter(L, 3, it);
 
-	for (int i = 1; i <= n; i++)
-	{
-		lua_pushvalue(L, 2);
-		lua_geti(L, 1, i);
-		lua_call(L, 1, 0);
-	}
+	lua_pushcclosure(L, script_iterator_next, 1);
 
-	return 0;
+	return 1;
 }
 
-// Same as foreach, but returns a list containing every element for which the function returned anything but nil or false
-// Also returns an integer containing the count as a second return value
-static int script_filter(lua_State* L)
+// Iterate over all monsters matching an optional filter
+static int script_monsters(lua_State* L)
 {
-	luaL_checktype(L, 1, LUA_TTABLE);
-	luaL_checktype(L, 2, LUA_TFUNCTION);
+	struct script_ud_iterator_t* it = script_iterator_new(L, 1);
+	script_iterator_filter(L, 1, it);
+	it->flags_required |= FILTER_MONSTER;
 
-	lua_len(L, 1);
-	int n = lua_tointeger(L, -1);
+	lua_pushcclosure(L, script_iterator_next, 1);
 
-	int count = 0;
+	return 1;
+}
 
-	lua_newtable(L);
+// Return a table of classname = chance for what an item can become when it respawns with g_dm_random_items,
+// or nil if it never changes
+static int script_substitutes(lua_State* L)
+{
+	const char* name = luaL_checkstring(L, 1);
 
-	for (int i = 1; i <= n; i++)
+	// Find the item
+	gitem_t* item = FindItemByClassname(name);
+
+	if (item == nullptr)
 	{
-		lua_pushvalue(L, 2);
-		lua_geti(L, 1, i);
-		lua_call(L, 1, 1);
+		const char* errstr = lua_pushfstring(L, "invalid item classname %s", name);
+		return luaL_argerror(L, 1, errstr);
+	}
 
-		int keep = lua_toboolean(L, -1);
-		lua_pop(L, 1);
+	const random_respawn_pool_t* pool = GetRandomRespawnPool(item->id);
 
-		if (keep)
+	if (!pool || pool->items.empty())
+	{
+		lua_pushnil(L);
+		return 1;
+	}
+
+	lua_createtable(L, 0, (int)pool->items.size());
+
+	float previous = 0.0f;
+
+	for (size_t i = 0; i < pool->items.size(); i++)
+	{
+		float chance;
+
+		if (pool->kind == random_respawn_pool_t::UNIFORM)
+			chance = 1.0f / pool->items.size();
+		else
 		{
-			lua_rawgeti(L, 1, i);
-			lua_rawseti(L, -2, ++count);
+			chance = pool->thresholds[i] - previous;
+			previous = pool->thresholds[i];
 		}
-	}
 
-	lua_pushinteger(L, count);
+		lua_pushnumber(L, chance);
+		lua_setfield(L, -2, GetItemByIndex(pool->items[i])->classname);
+	}
 
-	return 2;
+	return 1;
 }
 
-// Returns a randomly-selected element from the list
-static int script_pick(lua_State* L)
+// =============================================================================
+// Event handlers
+// =============================================================================
+
+// Scripts can register functions to be called when something happens in the game, instead
+// of relying on entities to be triggered or polling on a timer. Each handler is a reference
+// in the registry and can have a classname and/or targetname filter, which is checked here
+// before calling into Lua at all. The number of handlers for each event is exported so the
+// game can skip the call entirely when nothing is registered.
+
+// Event names for script.on; must be in the same order as script_event_t
+static const char* script_event_names[] =
 {
-	luaL_checktype(L, 1, LUA_TTABLE);
+	"spawn",
+	"damage",
+	"death",
+	"pickup",
+	"frame",
+	nullptr
+};
 
-	lua_len(L, 1);
-	int n = lua_tointeger(L, -1);
+// Maximum number of handlers for each event
+static const int32_t script_handlers_max = 64;
 
-	if (n == 0)
+// Filter strings are TAG_GAME copies rather than pooled strings, since the pool is TAG_LEVEL
+// and a level save being read frees that out from under a script that's still loaded
+struct script_handler_t
+{
+	int ref;
+	char* classname;
+	char* targetname;
+};
+
+static struct script_handler_t script_handlers[SCRIPT_EVENT_TOTAL][script_handlers_max];
+
+int32_t script_event_count[SCRIPT_EVENT_TOTAL];
+
+// Register a function to call when an event happens, with an optional table of filters
+static int script_on(lua_State* L)
+{
+	int event = luaL_checkoption(L, 1, nullptr, script_event_names);
+	luaL_checktype(L, 2, LUA_TFUNCTION);
+
+	if (!lua_isnoneornil(L, 3))
 	{
-		lua_pushnil(L);
+		luaL_checktype(L, 3, LUA_TTABLE);
 	}
-	else
+
+	if (script_event_count[event] >= script_handlers_max)
 	{
-		lua_geti(L, 1, 1 + irandom(n));
+		return luaL_error(L, "too many handlers for %s event", script_event_names[event]);
 	}
 
-	return 1;
-}
+	struct script_handler_t* handler = &script_handlers[event][script_event_count[event]];
 
-// Iterator function equivalent to the values iterator from Programming in Lua
-static int script_values_iterator(lua_State* L)
-{
-	// Increment the index
-	lua_pushvalue(L, lua_upvalueindex(2));
-	lua_pushinteger(L, 1);
-	lua_arith(L, LUA_OPADD);
+	handler->classname = nullptr;
+	handler->targetname = nullptr;
 
-	// Get the value of the index and overwrite the old upvalue
-	int i = lua_tointeger(L, -1);
-	lua_replace(L, lua_upvalueindex(2));
+	// Filters don't mean anything for frame events since there's no entity to compare them to
+	if (lua_type(L, 3) == LUA_TTABLE && event != SCRIPT_EVENT_FRAME)
+	{
+		lua_getfield(L, 3, "classname");
+		if (lua_isstring(L, -1))
+			handler->classname = G_CopyString(lua_tostring(L, -1), TAG_GAME);
 
-	// Return the element at that index
-	lua_geti(L, lua_upvalueindex(1), i);
+		lua_getfield(L, 3, "targetname");
+		if (lua_isstring(L, -1))
+			handler->targetname = G_CopyString(lua_tostring(L, -1), TAG_GAME);
 
-	return 1;
-}
+		lua_pop(L, 2);
+	}
 
-// Factory for the values iterator
-static int script_values(lua_State* L)
-{
-	// Argument must be a table and is the iterator's first upvalue
-	luaL_checktype(L, 1, LUA_TTABLE);
+	lua_pushvalue(L, 2);
+	handler->ref = luaL_ref(L, LUA_REGISTRYINDEX);
 
-	// Pop excess arguments
-	int n = lua_gettop(L);
+	script_event_count[event]++;
 
-	if (n > 1)
+	return 0;
+}
+
+// Release every handler; they belong to the script for the current level
+static void script_clear_handlers(lua_State* L)
+{
+	for (int event = 0; event < SCRIPT_EVENT_TOTAL; event++)
 	{
-		lua_pop(L, n - 1);
-	}
+		for (int i = 0; i < script_event_count[event]; i++)
+		{
+			struct script_handler_t* handler = &script_handlers[event][i];
 
-	// An index is the iterator's second upvalue
-	lua_pushinteger(L, 0);
+			luaL_unref(L, LUA_REGISTRYINDEX, handler->ref);
 
-	// Push the function as the return value
-	lua_pushcclosure(L, script_values_iterator, 2);
+			if (handler->classname)
+				gi.TagFree(handler->classname);
 
-	return 1;
+			if (handler->targetname)
+				gi.TagFree(handler->targetname);
+		}
+
+		script_event_count[event] = 0;
+	}
 }
 
 // =============================================================================
@@ -1502,7 +2485,7 @@ static const luaL_Reg script_vector_metamethods[] =
 	{"__unm", script_vector_neg},
 	{"__tostring", script_vector_tostring},
 	{"__index", nullptr},
-	{"__newindex", script_readonly},
+	{"__newindex", script_vector_newindex},
 	{nullptr, nullptr}
 };
 
@@ -1513,6 +2496,17 @@ static const luaL_Reg script_vector_functions[] =
 	{"direction", script_vector_direction},
 	{"distance", script_vector_distance},
 	{"lerp", script_vector_lerp},
+	{"add", script_vector_plus},
+	{"sub", script_vector_minus},
+	{"scale", script_vector_scale},
+	{"dot", script_vector_dot},
+	{"length", script_vector_length},
+	{"set_", script_vector_set_inplace},
+	{"copy_", script_vector_copy_inplace},
+	{"add_", script_vector_add_inplace},
+	{"sub_", script_vector_sub_inplace},
+	{"scale_", script_vector_scale_inplace},
+	{"normalize_", script_vector_normalize_inplace},
 	{nullptr, nullptr}
 };
 
@@ -1546,16 +2540,38 @@ static const luaL_Reg script_entity_functions[] =
 	{nullptr, nullptr}
 };
 
+// Template metamethods
+static const luaL_Reg script_template_metamethods[] =
+{
+	{"__index", nullptr},
+	{"__newindex", script_readonly},
+	{nullptr, nullptr}
+};
+
+// Template member functions
+static const luaL_Reg script_template_functions[] =
+{
+	{"spawn", script_template_spawn},
+	{"spawnmany", script_template_spawnmany},
+	{nullptr, nullptr}
+};
+
 // API functions
 static const luaL_Reg script_functions[] =
 {
 	{"spawn", script_spawn},
+	{"template", script_template},
+	{"on", script_on},
 	{"vector", script_vector},
 	{"find", script_find},
 	{"foreach", script_foreach},
 	{"filter", script_filter},
 	{"pick", script_pick},
 	{"values", script_values},
+	{"each", script_each},
+	{"near", script_near},
+	{"monsters", script_monsters},
+	{"substitutes", script_substitutes},
 	{nullptr, nullptr}
 };
 
@@ -1571,9 +2587,47 @@ static int script_panic(lua_State* L)
 static lua_State* L;
 static bool script_loaded;
 
+// Call a function in protected mode with the memory limit enforced
+// Running out of memory is reported here along with the map, and then handled by the caller like any other error
+static int script_pcall(int nargs, int nresults)
+{
+	script_protected++;
+	int status = lua_pcall(L, nargs, nresults, 0);
+	script_protected--;
+
+	if (status == LUA_ERRMEM)
+	{
+		gi.Com_PrintFmt("Script for map {} ran out of memory: {} bytes in use, limit is {} KB\n", level.mapname, script_memory.live, g_script_memory_limit->integer);
+	}
+
+	return status;
+}
+
+// Print memory usage for the scripting engine
+// This is one line of key=value pairs so it's easy for external monitoring to pick out of the console
+void script_memory_report()
+{
+	gi.Com_PrintFmt("script_mem: map={} live={} peak={} allocations={} frees={} refused={} limit={}\n",
+		level.mapname, script_memory.live, script_memory.peak, script_memory.allocations, script_memory.frees,
+		script_memory.refused, (size_t)max(0, g_script_memory_limit->integer) * 1024);
+}
+
 // Initialize the scripting engine
 void script_init()
 {
+	// Everything the last Lua state allocated is either gone or about to be, since it was TAG_GAME
+	script_memory = {};
+	script_protected = 0;
+
+	// Handlers and their filters belonged to the old state, and TAG_GAME is already gone, so
+	// forget them without touching either
+	script_loaded = false;
+
+	for (int event = 0; event < SCRIPT_EVENT_TOTAL; event++)
+	{
+		script_event_count[event] = 0;
+	}
+
 	// Initialize the string pool, which has a lifetime of TAG_GAME
 	script_stringpool_list = (char**)gi.TagMalloc(script_stringpool_starter * sizeof(char*), TAG_GAME);
 
@@ -1601,52 +2655,268 @@ void script_init()
 	lua_setmetatable(L, -2);
 	lua_setfield(L, -2, "vars");
 
-	// Add table for persistent variables, this remains valid for the lifetime of the scripting engine
-	lua_newtable(L);
-	lua_newtable(L);
-	lua_newtable(L);
-	lua_pushvalue(L, -1);
-	lua_setfield(L, LUA_REGISTRYINDEX, "script_persistent");
-	lua_setfield(L, -2, "__index");
-	lua_pushcfunction(L, script_persistent_set);
-	lua_setfield(L, -2, "__newindex");
-	lua_setmetatable(L, -2);
-	lua_setfield(L, -2, "persistent");
+	// Add table for persistent variables, this remains valid for the lifetime of the scripting engine
+	lua_newtable(L);
+	lua_newtable(L);
+	lua_newtable(L);
+	lua_pushvalue(L, -1);
+	lua_setfield(L, LUA_REGISTRYINDEX, "script_persistent");
+	lua_setfield(L, -2, "__index");
+	lua_pushcfunction(L, script_persistent_set);
+	lua_setfield(L, -2, "__newindex");
+	lua_setmetatable(L, -2);
+	lua_setfield(L, -2, "persistent");
+
+	// Add table for math library
+	luaopen_math(L);
+	script_table_readonly(L);
+	lua_setfield(L, -2, "math");
+
+	// Add table for string library
+	luaopen_string(L);
+	script_table_readonly(L);
+	lua_setfield(L, -2, "string");
+
+	// Add table for table library
+	luaopen_table(L);
+	script_table_readonly(L);
+	lua_setfield(L, -2, "table");
+
+	// Write protect API
+	script_table_readonly(L);
+
+	// Add API to the registry so it can be retrieved after a script is loaded
+	lua_setfield(L, LUA_REGISTRYINDEX, "script_api");
+
+	// Create metatable for vector objects
+	luaL_newmetatable(L, "script_vector");
+	luaL_setfuncs(L, script_vector_metamethods, 0);
+	luaL_newlib(L, script_vector_functions);
+	lua_pushcclosure(L, script_vector_index, 1);
+	lua_setfield(L, -2, "__index");
+	lua_pop(L, 1);
+
+	// Create metatable for entity objects
+	luaL_newmetatable(L, "script_entity");
+	luaL_setfuncs(L, script_entity_metamethods, 0);
+	luaL_newlib(L, script_entity_functions);
+	lua_setfield(L, -2, "__index");
+	lua_pop(L, 1);
+
+	// Create metatable for template objects
+	luaL_newmetatable(L, "script_template");
+	luaL_setfuncs(L, script_template_metamethods, 0);
+	luaL_newlib(L, script_template_functions);
+	lua_setfield(L, -2, "__index");
+	lua_pop(L, 1);
+}
+
+// =============================================================================
+// Background compilation
+// =============================================================================
+
+// Reading and compiling the next map's script used to happen right at the end of SpawnEntities,
+// on the critical path of the level load. When a changelevel fires there is usually plenty of
+// time left (intermission, fades, the engine loading the BSP) so the script is compiled on a
+// worker thread in a throwaway Lua state and dumped to bytecode, and script_load only has to
+// load that buffer. The scratch state uses Lua's default allocator since the engine's TagMalloc
+// can't be called off the main thread. If the bytecode isn't ready by the time script_load runs,
+// it just compiles the file itself like it always did and the worker's result is thrown away.
+
+struct script_prefetch_t
+{
+	std::string mapname;
+	std::string path;
+	std::thread worker;
+	// Set by the worker once everything below is written
+	std::atomic<bool> done { false };
+	bool ok = false;
+	std::string bytecode;
+	double compile_ms = 0;
+};
+
+static std::unique_ptr<script_prefetch_t> script_prefetch_job;
+
+struct script_prefetch_stats_t
+{
+	// Compiles started on the worker
+	size_t started;
+	// Scripts loaded from prefetched bytecode
+	size_t used;
+	// Prefetch for the right map that hadn't finished yet
+	size_t not_ready;
+	// Prefetch that finished but failed to compile, so the normal path reports the error
+	size_t failed;
+	// Loads with no matching prefetch at all (new game, map command, save load)
+	size_t unprefetched;
+	// Compile time taken off the critical path, and compile time still spent on it
+	double overlap_ms;
+	double sync_ms;
+};
+
+static script_prefetch_stats_t script_prefetch_stats;
+
+static std::string script_path(const char* mapname)
+{
+	return G_Fmt("./{}/scripts/{}.lua", gi.cvar("gamedir", "", CVAR_NOFLAGS)->string, mapname).data();
+}
+
+static int script_dump_writer(lua_State* L, const void* p, size_t sz, void* ud)
+{
+	((std::string*)ud)->append((const char*)p, sz);
+	return 0;
+}
+
+static void script_prefetch_worker(script_prefetch_t* job)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	lua_State* S = luaL_newstate();
+
+	if (S)
+	{
+		if (luaL_loadfile(S, job->path.c_str()) == LUA_OK)
+			job->ok = lua_dump(S, script_dump_writer, &job->bytecode, 0) == 0;
+
+		lua_close(S);
+	}
+
+	job->compile_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	job->done.store(true, std::memory_order_release);
+}
+
+// Wait for and throw away any outstanding prefetch
+static void script_prefetch_discard()
+{
+	if (!script_prefetch_job)
+		return;
+
+	if (script_prefetch_job->worker.joinable())
+		script_prefetch_job->worker.join();
+
+	script_prefetch_job.reset();
+}
+
+// Start compiling the script for the map a changelevel is heading to
+// This takes the same string as level.changemap: an optional leading * for a new unit, an optional
+// $spawnpoint suffix, and possibly a cinematic or image before a + which is skipped
+void script_prefetch(const char* changemap)
+{
+	if (!changemap || !*changemap)
+		return;
+
+	std::string_view map = changemap;
+
+	if (map[0] == '*')
+		map.remove_prefix(1);
+
+	if (size_t plus = map.find_last_of('+'); plus != std::string_view::npos)
+		map.remove_prefix(plus + 1);
+
+	if (size_t spawn = map.find_first_of('$'); spawn != std::string_view::npos)
+		map = map.substr(0, spawn);
+
+	// Cinematics and end-of-game images have no script
+	if (map.empty() || map.find_first_of('.') != std::string_view::npos)
+		return;
+
+	if (script_prefetch_job && script_prefetch_job->mapname == map)
+		return;
+
+	script_prefetch_discard();
+
+	script_prefetch_job = std::make_unique<script_prefetch_t>();
+	script_prefetch_job->mapname = map;
+	script_prefetch_job->path = script_path(script_prefetch_job->mapname.c_str());
+	script_prefetch_job->worker = std::thread(script_prefetch_worker, script_prefetch_job.get());
+	script_prefetch_stats.started++;
+}
+
+// Load the map's script onto the stack, from prefetched bytecode if it's ready
+static int script_load_chunk(const char* mapname)
+{
+	std::string path = script_path(mapname);
+
+	if (script_prefetch_job && script_prefetch_job->mapname == mapname)
+	{
+		if (script_prefetch_job->done.load(std::memory_order_acquire))
+		{
+			script_prefetch_job->worker.join();
+
+			if (script_prefetch_job->ok)
+			{
+				int status = luaL_loadbufferx(L, script_prefetch_job->bytecode.data(), script_prefetch_job->bytecode.size(),
+					G_Fmt("@{}", path).data(), "b");
+
+				if (status == LUA_OK)
+				{
+					script_prefetch_stats.used++;
+					script_prefetch_stats.overlap_ms += script_prefetch_job->compile_ms;
+					script_prefetch_job.reset();
+					return status;
+				}
+
+				lua_pop(L, 1);
+			}
+
+			script_prefetch_stats.failed++;
+			script_prefetch_job.reset();
+		}
+		else
+		{
+			// Leave it running, it gets joined the next time a prefetch starts or the game shuts down
+			script_prefetch_stats.not_ready++;
+		}
+	}
+	else
+	{
+		script_prefetch_stats.unprefetched++;
 
-	// Add table for math library
-	luaopen_math(L);
-	script_table_readonly(L);
-	lua_setfield(L, -2, "math");
+		// A prefetch for some other map that's already finished can go now
+		if (script_prefetch_job && script_prefetch_job->done.load(std::memory_order_acquire))
+			script_prefetch_discard();
+	}
 
-	// Add table for string library
-	luaopen_string(L);
-	script_table_readonly(L);
-	lua_setfield(L, -2, "string");
+	auto start = std::chrono::steady_clock::now();
+	int status = luaL_loadfile(L, path.c_str());
+	script_prefetch_stats.sync_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 
-	// Add table for table library
-	luaopen_table(L);
-	script_table_readonly(L);
-	lua_setfield(L, -2, "table");
+	return status;
+}
 
-	// Write protect API
-	script_table_readonly(L);
+// Print how much script compilation has been moved off level loads
+void script_prefetch_report()
+{
+	gi.Com_PrintFmt("script_prefetch: started={} used={} not_ready={} failed={} unprefetched={} overlap_ms={:.2f} sync_ms={:.2f}\n",
+		script_prefetch_stats.started, script_prefetch_stats.used, script_prefetch_stats.not_ready, script_prefetch_stats.failed,
+		script_prefetch_stats.unprefetched, script_prefetch_stats.overlap_ms, script_prefetch_stats.sync_ms);
+}
 
-	// Add API to the registry so it can be retrieved after a script is loaded
-	lua_setfield(L, LUA_REGISTRYINDEX, "script_api");
+// Don't leave a worker running when the game library goes away
+void script_shutdown()
+{
+	script_prefetch_discard();
+}
 
-	// Create metatable for vector objects
-	luaL_newmetatable(L, "script_vector");
-	luaL_setfuncs(L, script_vector_metamethods, 0);
-	luaL_newlib(L, script_vector_functions);
-	lua_setfield(L, -2, "__index");
-	lua_pop(L, 1);
+// Called right before TAG_LEVEL is freed by a level change
+// The old script's handlers would otherwise run while the new map's entities spawn, and the
+// string pool would be left pointing at freed strings
+void script_unload()
+{
+	script_loaded = false;
+	script_stringpool_count = 0;
 
-	// Create metatable for entity objects
-	luaL_newmetatable(L, "script_entity");
-	luaL_setfuncs(L, script_entity_metamethods, 0);
-	luaL_newlib(L, script_entity_functions);
-	lua_setfield(L, -2, "__index");
-	lua_pop(L, 1);
+	if (L)
+	{
+		script_clear_handlers(L);
+	}
+}
+
+// Called right before TAG_LEVEL is freed when a level save is read
+// The script that SpawnEntities just loaded for this map stays, only its pooled strings go
+void script_release_level_strings()
+{
+	script_stringpool_count = 0;
 }
 
 // Load and execute a script for a given map
@@ -1657,6 +2927,12 @@ void script_load(const char* mapname)
 	// Strings are all tagged TAG_LEVEL so they're freed by now
 	script_stringpool_count = 0;
 
+	// Any templates that survived from the last level need to be prepared again
+	script_load_count++;
+
+	// Event handlers belong to the last level's script
+	script_clear_handlers(L);
+
 	// Create the trigger stack table, or replace it with an empty one
 	// If it exists already it should probably be empty by the time a level transition happens,
 	// but it's probably safest to not assume that
@@ -1677,6 +2953,9 @@ void script_load(const char* mapname)
 	// May as well run a full garbage-collection cycle here
 	lua_gc(L, LUA_GCCOLLECT);
 
+	// Peak memory usage is tracked per map
+	script_memory.peak = script_memory.live;
+
 	// Add a setup metatable to the global proxy table
 	lua_rawgeti(L, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
 	lua_newtable(L);
@@ -1685,7 +2964,7 @@ void script_load(const char* mapname)
 	lua_setmetatable(L, -2);
 
 	// Attempt to load the script for the current map
-	if (luaL_loadfile(L, G_Fmt("./{}/scripts/{}.lua", gi.cvar("gamedir", "", CVAR_NOFLAGS)->string, mapname).data()) != LUA_OK)
+	if (script_load_chunk(mapname) != LUA_OK)
 	{
 		const char* errstr = lua_tostring(L, -1);
 		gi.Com_PrintFmt("Error loading script for map {}: {}\n", mapname, errstr);
@@ -1694,11 +2973,12 @@ void script_load(const char* mapname)
 	}
 
 	// Attempt to execute the script
-	if (lua_pcall(L, 0, 0, 0) != LUA_OK)
+	if (script_pcall(0, 0) != LUA_OK)
 	{
 		const char* errstr = lua_tostring(L, -1);
 		gi.Com_PrintFmt("Error executing script for map {}: {}\n", mapname, errstr);
 		lua_pop(L, 2);
+		script_clear_handlers(L);
 		return;
 	}
 
@@ -1725,23 +3005,29 @@ void script_load(const char* mapname)
 // units, while crosslevel variables persist until a new game is started (via menu or map
 // command) or a save game is loaded.
 
-// During saving, each variable is encoded as a text string containing its type and a text
-// representation of its value, separated by a colon. Booleans and strings are probably
-// self-explanatory. Numbers are not marked as float or integer; their subtype is implied
-// by their string representation (whether or not it contains a decimal point.) Entities are
-// stored as their offset in the entity array, but entities that are invalid by the time
-// the save occurs are saved with an offset of -1. Vectors are stored as their three components
-// separated by comma.
+// Variables are written straight into the save as typed JSON values, inside an object that
+// also records the format version:
+// { "format": 2, "values": { "name": value, ... } }
+// Numbers, booleans, and strings are written as the equivalent JSON types; integers and floats
+// are told apart by JSON's integer and real types, and floats are written with enough digits to
+// come back exactly. Vectors are arrays of three numbers. Entities are objects containing their
+// offset in the entity array, but entities that are invalid by the time the save occurs are saved
+// with an offset of -1.
 
-// During loading, the process is reversed, creating objects from the string representations
-// and adding them to the table in question. Invalid entities will still be invalid; they will
-// no longer point to the original slot, but that is entirely immaterial and all that matters
-// is that they know they are invalid.
+// Older saves have no format number, and each variable is encoded as a text string containing
+// its type and a text representation of its value, separated by a colon. Vectors are stored as
+// their three components separated by comma. These can still be loaded.
 
-// Get variables for saving
-void script_get_variables(std::unordered_map<std::string, std::string>& variables, bool persistent)
+// During loading, the process is reversed, creating objects from the saved values and adding
+// them to the table in question. Invalid entities will still be invalid; they will no longer
+// point to the original slot, but that is entirely immaterial and all that matters is that they
+// know they are invalid.
+
+static const int32_t script_variables_format = 2;
+
+// Push the table of variables being saved or loaded
+static void script_push_variables_table(bool persistent)
 {
-	// Get the specified table
 	if (persistent)
 	{
 		lua_getfield(L, LUA_REGISTRYINDEX, "script_persistent");
@@ -1750,122 +3036,388 @@ void script_get_variables(std::unordered_map<std::string, std::string>& variable
 	{
 		lua_getfield(L, LUA_REGISTRYINDEX, "script_vars");
 	}
+}
+
+// Push an entity from its saved offset, where -1 means it was invalid at save time
+static void script_push_saved_entity(int32_t n)
+{
+	if (n < 0 || n >= (int32_t)globals.max_edicts)
+	{
+		// Invalid entities are referenced to worldspawn but with a spawn_count of -1
+		// Since worldspawn's slot is never recycled, let alone over 4 billion times,
+		// this should be completely safe
+		struct script_ud_ent_t* ud = (struct script_ud_ent_t*)lua_newuserdatauv(L, sizeof(struct script_ud_ent_t), 0);
+
+		ud->ent = g_edicts;
+		ud->spawn_count = -1;
+
+		luaL_setmetatable(L, "script_entity");
+	}
+	else
+	{
+		script_push_entity(L, g_edicts + n);
+	}
+}
+
+// Write variables into a save
+void script_write_variables(Json::Value& json, bool persistent)
+{
+	json = Json::Value(Json::objectValue);
+	json["format"] = script_variables_format;
+
+	Json::Value& values = json["values"] = Json::Value(Json::objectValue);
+
+	script_push_variables_table(persistent);
 
 	// Walk the table
 	lua_pushnil(L);
 
 	while (lua_next(L, -2) != 0)
 	{
-		// luaL_tolstring puts the converted string on the stack as a new object
-		// There's no need to interact with this copy on the stack, but it stops
-		// the original variables from getting mangled
-		const char* key = luaL_tolstring(L, -2, nullptr);
-		const char* str = luaL_tolstring(L, -2, nullptr);
+		// Keys are always strings, which is enforced when they're set
+		size_t key_length;
+		const char* key = lua_tolstring(L, -2, &key_length);
 
-		int type = lua_type(L, -3);
+		switch (lua_type(L, -1))
+		{
+		case LUA_TNUMBER:
+			if (lua_isinteger(L, -1))
+			{
+				values[key] = Json::Value((Json::Int64)lua_tointeger(L, -1));
+			}
+			else
+			{
+				values[key] = Json::Value(lua_tonumber(L, -1));
+			}
+			break;
 
-		std::string val;
+		case LUA_TBOOLEAN:
+			values[key] = Json::Value((bool)lua_toboolean(L, -1));
+			break;
 
-		if (type == LUA_TUSERDATA)
+		case LUA_TSTRING:
 		{
-			// Encoding of type and values is handled by __tostring so everything is already here
-			val += str;
-		}
-		else
-		{
-			// Simple values are encoded as type:value
-			val += lua_typename(L, type);
-			val += ':';
-			val += str;
+			size_t length;
+			const char* str = lua_tolstring(L, -1, &length);
+			values[key] = Json::Value(str, str + length);
+			break;
 		}
 
-		variables.insert_or_assign(key, val);
+		case LUA_TUSERDATA:
+			if (vec3_t* vec = (vec3_t*)luaL_testudata(L, -1, "script_vector"))
+			{
+				Json::Value& array = values[key] = Json::Value(Json::arrayValue);
+				array.append(vec->x);
+				array.append(vec->y);
+				array.append(vec->z);
+			}
+			else if (luaL_testudata(L, -1, "script_entity"))
+			{
+				edict_t* ent = script_check_entity(L, -1, false);
+				values[key]["entity"] = (ent != nullptr) ? (int32_t)(ent - g_edicts) : -1;
+			}
+			break;
+		}
 
-		lua_pop(L, 3);
+		lua_pop(L, 1);
 	}
 
 	lua_pop(L, 1);
 }
 
-// Set variables after loading
-void script_set_variables(std::unordered_map<std::string, std::string>& variables, bool persistent)
+// Decode a variable from an older save, encoded as type:value
+static void script_push_legacy_variable(const char* str)
 {
-	// Get the specified table
-	if (persistent)
+	// Separate the type and value
+	const char* separator = strchr(str, ':');
+
+	std::string_view type = separator ? std::string_view(str, separator - str) : std::string_view(str);
+	const char* value = separator ? separator + 1 : "";
+
+	// Handle each type
+	if (type == "number")
 	{
-		lua_getfield(L, LUA_REGISTRYINDEX, "script_persistent");
+		if (lua_stringtonumber(L, value) == 0)
+		{
+			lua_pushinteger(L, 0);
+		}
+	}
+	else if (type == "boolean")
+	{
+		lua_pushboolean(L, !strcmp(value, "true"));
+	}
+	else if (type == "vector")
+	{
+		vec3_t vec = {};
+		char* end;
+
+		vec.x = strtof(value, &end);
+		vec.y = (*end == ',') ? strtof(end + 1, &end) : 0;
+		vec.z = (*end == ',') ? strtof(end + 1, &end) : 0;
+
+		script_push_vector(L, vec);
+	}
+	else if (type == "entity")
+	{
+		script_push_saved_entity(atoi(value));
 	}
 	else
 	{
-		lua_getfield(L, LUA_REGISTRYINDEX, "script_vars");
+		// Assume it's a string if it doesn't match any of the other types
+		lua_pushstring(L, value);
+	}
+}
+
+// Read variables from a save
+void script_read_variables(const Json::Value& json, bool persistent)
+{
+	if (!json.isObject())
+	{
+		return;
 	}
 
-	for (auto it = variables.begin(); it != variables.end(); ++it)
+	const Json::Value& format = json["format"];
+
+	// Older saves have no format number and the variables are the members of the object itself
+	bool legacy = !format.isInt();
+
+	const Json::Value& values = legacy ? json : json["values"];
+
+	if (!values.isObject())
 	{
-		std::string key = it->first;
-		std::string str = it->second;
+		return;
+	}
 
-		// Separate the type and value
-		size_t loc = str.find_first_of(':');
-		std::string str_type = str.substr(0, loc);
-		std::string str_val = str.substr(loc + 1);
+	script_push_variables_table(persistent);
+
+	for (auto it = values.begin(); it != values.end(); ++it)
+	{
+		const char* key_end;
+		const char* key = it.memberName(&key_end);
+		const Json::Value& value = *it;
 
 		// Key has to go on before value for rawset
-		lua_pushstring(L, key.c_str());
+		lua_pushlstring(L, key, key_end - key);
 
-		// Handle each type
-		if (str_type == "number")
-		{
-			lua_stringtonumber(L, str_val.c_str());
-		}
-		else if (str_type == "boolean")
+		if (legacy)
 		{
-			lua_pushboolean(L, str_val == "true");
+			if (!value.isString())
+			{
+				lua_pop(L, 1);
+				continue;
+			}
+
+			script_push_legacy_variable(value.asCString());
 		}
-		else if (str_type == "vector")
+		else
 		{
-			size_t loc1 = str_val.find_first_of(',');
-			size_t loc2 = str_val.find_first_of(',', loc1 + 1);
+			switch (value.type())
+			{
+			case Json::intValue:
+				lua_pushinteger(L, value.asInt64());
+				break;
 
-			vec3_t vec = {};
-			vec.x = std::stof(str_val.substr(0, loc1));
-			vec.y = std::stof(str_val.substr(loc1 + 1, loc2));
-			vec.z = std::stof(str_val.substr(loc2 + 1));
+			case Json::uintValue:
+				lua_pushinteger(L, (lua_Integer)value.asUInt64());
+				break;
 
-			script_push_vector(L, vec);
-		}
-		else if (str_type == "entity")
-		{
-			int32_t n = std::stoi(str_val);
+			case Json::realValue:
+				lua_pushnumber(L, value.asDouble());
+				break;
 
-			// Check entity for validity; an index of -1 means it was invalid at save time
-			if (n == -1)
+			case Json::booleanValue:
+				lua_pushboolean(L, value.asBool());
+				break;
+
+			case Json::stringValue:
+			{
+				const char* str_begin;
+				const char* str_end;
+				value.getString(&str_begin, &str_end);
+				lua_pushlstring(L, str_begin, str_end - str_begin);
+				break;
+			}
+
+			case Json::arrayValue:
 			{
-				// Invalid entities are referenced to worldspawn but with a spawn_count of -1
-				// Since worldspawn's slot is never recycled, let alone over 4 billion times,
-				// this should be completely safe
-				struct script_ud_ent_t* ud = (struct script_ud_ent_t*)lua_newuserdata(L, sizeof(struct script_ud_ent_t*));
+				vec3_t vec = {};
 
-				ud->ent = g_edicts;
-				ud->spawn_count = -1;
+				if (value.size() == 3)
+				{
+					vec.x = value[0].asFloat();
+					vec.y = value[1].asFloat();
+					vec.z = value[2].asFloat();
+				}
 
-				luaL_setmetatable(L, "script_entity");
+				script_push_vector(L, vec);
+				break;
 			}
-			else
-			{
-				script_push_entity(L, g_edicts + n);
+
+			case Json::objectValue:
+				script_push_saved_entity(value["entity"].asInt());
+				break;
+
+			default:
+				lua_pop(L, 1);
+				continue;
 			}
 		}
+
+		lua_rawset(L, -3);
+	}
+
+	lua_pop(L, 1);
+}
+
+// =============================================================================
+// Trigger stack
+// =============================================================================
+
+// The trigger stack keeps track of which entity called into the script and who activated it,
+// so that entities triggered from the script get the right self and activator
+
+// Push a trigger context, returning its index so it can be removed afterward
+static int script_triggerstack_push(edict_t* self, edict_t* activator)
+{
+	lua_getfield(L, LUA_REGISTRYINDEX, "script_triggerstack");
+	int n = luaL_len(L, -1);
+
+	lua_newtable(L);
+
+	lua_pushlightuserdata(L, self);
+	lua_setfield(L, -2, "self");
+
+	lua_pushlightuserdata(L, activator);
+	lua_setfield(L, -2, "activator");
+
+	lua_seti(L, -2, n + 1);
+	lua_pop(L, 1);
+
+	return n + 1;
+}
+
+// Remove a trigger context
+static void script_triggerstack_pop(int n)
+{
+	lua_getfield(L, LUA_REGISTRYINDEX, "script_triggerstack");
+	lua_pushnil(L);
+	lua_seti(L, -2, n);
+	lua_pop(L, 1);
+}
+
+// =============================================================================
+// Event dispatch
+// =============================================================================
+
+// Handlers can cause more events, like a damage handler damaging something else, so
+// there's a limit on how deeply they can nest to keep that from going on forever
+static const int32_t script_event_depth_max = 8;
+static int32_t script_event_depth;
+
+// Check a handler's filters against an entity
+static bool script_handler_matches(const struct script_handler_t* handler, edict_t* ent)
+{
+	if (handler->classname && (!ent->classname || Q_strcasecmp(handler->classname, ent->classname)))
+	{
+		return false;
+	}
+
+	if (handler->targetname && (!ent->targetname || Q_strcasecmp(handler->targetname, ent->targetname)))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+// Call a handler with arguments already on the stack above its function
+static void script_handler_call(int event, int nargs)
+{
+	if (script_pcall(nargs, 0) != LUA_OK)
+	{
+		const char* errstr = lua_tostring(L, -1);
+		gi.Com_PrintFmt("Error calling {} handler: {}\n", script_event_names[event], errstr);
+		lua_pop(L, 1);
+	}
+}
+
+// Call the handlers for an event involving an entity
+// The handler gets the entity, the other entity involved (if any), and an amount (if any)
+void script_event_entity(script_event_t event, edict_t* ent, edict_t* other, int32_t amount)
+{
+	if (!script_loaded || script_event_depth >= script_event_depth_max)
+	{
+		return;
+	}
+
+	script_event_depth++;
+
+	// Entities triggered from the handler see the entity as self, like targets fired by an entity
+	int n = script_triggerstack_push(ent, other ? other : ent);
+
+	// Handlers registered by other handlers only get called next time
+	int32_t count = script_event_count[event];
+
+	for (int i = 0; i < count; i++)
+	{
+		const struct script_handler_t* handler = &script_handlers[event][i];
+
+		// The entity can be freed by an earlier handler
+		if (!ent->inuse)
+		{
+			break;
+		}
+
+		if (!script_handler_matches(handler, ent))
+		{
+			continue;
+		}
+
+		lua_rawgeti(L, LUA_REGISTRYINDEX, handler->ref);
+		script_push_entity(L, ent);
+
+		if (other != nullptr)
+		{
+			script_push_entity(L, other);
+		}
 		else
 		{
-			// Assume it's a string if it doesn't match any of the other types
-			lua_pushstring(L, str_val.c_str());
+			lua_pushnil(L);
 		}
 
-		lua_rawset(L, -3);
+		lua_pushinteger(L, amount);
+
+		script_handler_call(event, 3);
 	}
 
-	lua_pop(L, 1);
+	script_triggerstack_pop(n);
+
+	script_event_depth--;
+}
+
+// Call the handlers for the end of a server frame
+void script_event_frame()
+{
+	if (!script_loaded)
+	{
+		return;
+	}
+
+	script_event_depth++;
+
+	int n = script_triggerstack_push(world, world);
+
+	int32_t count = script_event_count[SCRIPT_EVENT_FRAME];
+
+	for (int i = 0; i < count; i++)
+	{
+		lua_rawgeti(L, LUA_REGISTRYINDEX, script_handlers[SCRIPT_EVENT_FRAME][i].ref);
+		script_handler_call(SCRIPT_EVENT_FRAME, 0);
+	}
+
+	script_triggerstack_pop(n);
+
+	script_event_depth--;
 }
 
 // =============================================================================
@@ -1908,26 +3460,14 @@ static USE(script_use) (edict_t* self, edict_t* other, edict_t* activator) -> vo
 	}
 
 	// Add trigger context to stack
-	lua_getfield(L, LUA_REGISTRYINDEX, "script_triggerstack");
-	int n = luaL_len(L, -1);
-
-	lua_newtable(L);
-
-	lua_pushlightuserdata(L, self);
-	lua_setfield(L, -2, "self");
-
-	lua_pushlightuserdata(L, activator);
-	lua_setfield(L, -2, "activator");
-
-	lua_seti(L, -2, n + 1);
-	lua_pop(L, 1);
+	int n = script_triggerstack_push(self, activator);
 
 	// Call the function
 	script_push_entity(L, self);
 	script_push_entity(L, other);
 	script_push_entity(L, activator);
 
-	if (lua_pcall(L, 3, 0, 0) != LUA_OK)
+	if (script_pcall(3, 0) != LUA_OK)
 	{
 		const char* errstr = lua_tostring(L, -1);
 		gi.Com_PrintFmt("{} error calling function {}: {}\n", *self, self->script_function, errstr);
@@ -1935,10 +3475,7 @@ static USE(script_use) (edict_t* self, edict_t* other, edict_t* activator) -> vo
 	}
 
 	// Remove top of trigger stack
-	lua_getfield(L, LUA_REGISTRYINDEX, "script_triggerstack");
-	lua_pushnil(L);
-	lua_seti(L, -2, n + 1);
-	lua_pop(L, 1);
+	script_triggerstack_pop(n);
 }
 
 void SP_script(edict_t* self)
@@ -0,0 +1,37 @@
+-- Exercises script.each, script.near and script.monsters with and without a filter table.
+-- Copy to <gamedir>/scripts/<mapname>.lua for a map with monsters in it (base1 works) and load
+-- the map; any failure shows up as "Error executing script for map ..." in the console.
+
+-- There's no error() in the sandbox, but an invalid event name gets the message into the error
+local function check(ok, message)
+	if not ok then
+		script.on(message)
+	end
+end
+
+local function count(iterator)
+	local n = 0
+	for ent in iterator do
+		n = n + 1
+	end
+	return n
+end
+
+local everywhere = script.vector(0, 0, 0)
+local radius = 65536
+
+local all = count(script.each())
+local all_filtered = count(script.each({ monster = true }))
+
+local near = count(script.near(everywhere, radius))
+local near_filtered = count(script.near(everywhere, radius, { monster = true }))
+
+local monsters = count(script.monsters())
+local monsters_filtered = count(script.monsters({ dead = false }))
+
+check(all > 0, "each() found nothing")
+check(all_filtered <= all, "each() with a filter found more than without")
+check(all_filtered == monsters, "each({ monster = true }) and monsters() disagree")
+check(near <= all, "near() found more than each()")
+check(near_filtered <= near, "near() with a filter found more than without")
+check(monsters_filtered <= monsters, "monsters() with a filter found more than without")